@@ -0,0 +1,122 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+static char *benchname = "bench";
+static char *benchargs = "";
+
+void
+benchinit(char *name, char *args)
+{
+  benchname = name;
+  benchargs = args;
+}
+
+void
+usage(void)
+{
+  printf(1, "usage: %s %s\n", benchname, benchargs);
+  exit();
+}
+
+void
+fail(const char *s)
+{
+  printf(1, "[%s] FAIL: %s\n", benchname, s);
+  exit();
+}
+
+void
+benchpipes(int go[2], int done[2])
+{
+  if(pipe(go) < 0 || pipe(done) < 0) fail("pipe");
+}
+
+// Fork a worker: the child drops the parent's ends of go and done and
+// gets 0, the parent the child's pid.
+int
+benchfork(int go[2], int done[2])
+{
+  int pid = fork();
+
+  if(pid < 0) fail("fork");
+  if(pid == 0){
+    close(go[1]);
+    close(done[0]);
+  }
+  return pid;
+}
+
+// Drop the workers' ends of the pipes and release n of them to run
+// for ticks ticks. Returns the tick they stop at.
+int
+benchgo(int go[2], int done[2], int n, int ticks)
+{
+  int stop = uptime() + ticks;
+
+  close(go[0]);
+  close(done[1]);
+  for(int i = 0; i < n; i++)
+    if(write(go[1], &stop, sizeof(stop)) != sizeof(stop)) fail("write go");
+  return stop;
+}
+
+// In a worker: wait to be released; returns the tick to stop at.
+int
+benchstop(int go)
+{
+  int stop;
+
+  if(read(go, &stop, sizeof(stop)) != sizeof(stop)) fail("read go");
+  return stop;
+}
+
+// Read one worker's report of size bytes.
+void
+benchread(int done, void *r, int size)
+{
+  if(read(done, r, size) != size) fail("read done");
+}
+
+void
+benchspin(int n)
+{
+  volatile uint x = 0;
+
+  for(int i = 0; i < n; i++)
+    x += i;
+}
+
+// Spinning worker: at the given tickets, spin units of unit iterations
+// until the stop tick, report them tagged with tag, and exit.
+void
+benchworker(int tag, int tickets, int unit, int go, int done)
+{
+  struct benchres r;
+  int stop;
+
+  r.tag = tag;
+  r.work = 0;
+  if(settickets(tickets, 0) < 0) fail("settickets");
+  stop = benchstop(go);
+  while(uptime() < stop){
+    benchspin(unit);
+    r.work++;
+  }
+  write(done, &r, sizeof(r));
+  exit();
+}
+
+// Read n spinning workers' reports into res; returns their total work.
+uint
+benchcollect(int done, struct benchres *res, int n)
+{
+  uint total = 0;
+
+  for(int i = 0; i < n; i++){
+    benchread(done, &res[i], sizeof(res[i]));
+    total += res[i].work;
+  }
+  return total;
+}
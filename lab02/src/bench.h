@@ -0,0 +1,30 @@
+// Harness shared by the benchmark programs (bench.c, part of ULIB).
+//
+// A benchmark names itself with benchinit() before anything can fail;
+// usage() and fail() then print under that name and exit. Its workers
+// are forked with benchfork() between a go pipe, on which benchgo()
+// releases them all at once with the tick to stop at, and a done pipe
+// they report on.
+
+// Loop iterations in one unit of work of a spinning worker
+#define BENCH_UNIT 100000
+
+// Report of a spinning worker (benchworker)
+struct benchres {
+  int tag;        // the caller's: tickets, group, kind of worker...
+  uint work;      // units done
+};
+
+void benchinit(char *name, char *args);
+void usage(void);
+void fail(const char *s);
+
+void benchpipes(int go[2], int done[2]);
+int benchfork(int go[2], int done[2]);
+int benchgo(int go[2], int done[2], int n, int ticks);
+int benchstop(int go);
+void benchread(int done, void *r, int size);
+
+void benchspin(int n);
+void benchworker(int tag, int tickets, int unit, int go, int done);
+uint benchcollect(int done, struct benchres *res, int n);
@@ -0,0 +1,99 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define NMAX 32
+#define MAXCPU 8
+#define LINE 64         // bytes per cache line
+
+struct result {
+  uint passes;        // passes over the array
+  uint migrations;    // moves to another CPU's run queue
+};
+
+// worker: pass over an array of kb KB a cache line at a time until the
+// stop tick, optionally pinned to one CPU
+static void
+worker(int cpu, int kb, int go, int done)
+{
+  struct result r;
+  struct affinity a;
+  char *buf;
+  int stop, n = kb * 1024;
+
+  if(cpu >= 0 && setaffinity(getpid(), 1 << cpu) < 0) fail("setaffinity");
+  if((buf = malloc(n)) == 0) fail("malloc");
+  memset(buf, 0, n);
+  r.passes = 0;
+  stop = benchstop(go);
+  while(uptime() < stop){
+    for(int i = 0; i < n; i += LINE)
+      buf[i]++;
+    r.passes++;
+  }
+  if(getaffinity(getpid(), &a) < 0) fail("getaffinity");
+  r.migrations = a.migrations;
+  write(done, &r, sizeof(r));
+  exit();
+}
+
+// One run, pinned (worker i to CPU i mod ncpu) or left to the scheduler
+static void
+run(int pinned, int ticks, int n, int kb, int ncpu)
+{
+  int go[2], done[2], i;
+  uint passes = 0, migrations = 0, least = ~0;
+  struct result r;
+
+  benchpipes(go, done);
+  for(i = 0; i < n; i++)
+    if(benchfork(go, done) == 0)
+      worker(pinned ? i % ncpu : -1, kb, go[0], done[1]);
+  benchgo(go, done, n, ticks);
+  for(i = 0; i < n; i++){
+    benchread(done[0], &r, sizeof(r));
+    passes += r.passes;
+    migrations += r.migrations;
+    if(r.passes < least)
+      least = r.passes;
+  }
+  for(i = 0; i < n; i++)
+    wait();
+  close(go[1]);
+  close(done[0]);
+
+  printf(1, "%s\t%d\t%d\t%d\n", pinned ? "pinned" : "free",
+         passes / ticks, least / ticks, migrations);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpustat cs[MAXCPU];
+  int ticks = 300;
+  int kb = 256;         // about an L2
+  int n = -1;           // workers; default one more than the CPUs
+  int ncpu, i;
+
+  benchinit("cachebench", "[-t ticks] [-n workers] [-k kbytes]");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-' || i + 1 >= argc) usage();
+    if(argv[i][1] == 't') ticks = atoi(argv[++i]);
+    else if(argv[i][1] == 'n') n = atoi(argv[++i]);
+    else if(argv[i][1] == 'k') kb = atoi(argv[++i]);
+    else usage();
+  }
+  if((ncpu = cpustat(cs, MAXCPU)) < 0) fail("cpustat");
+  if(n < 0)
+    n = ncpu + 1;
+  if(ticks <= 0 || n <= 0 || n > NMAX || kb <= 0) usage();
+
+  // An uneven number of workers keeps the balancer busy when free.
+  printf(1, "[cachebench] %d workers on %d CPUs, %d KB each, %d ticks\n",
+         n, ncpu, kb, ticks);
+  printf(1, "[placement]\t[passes/tick]\t[slowest worker]\t[migrations]\n");
+  run(0, ticks, n, kb, ncpu);
+  run(1, ticks, n, kb, ncpu);
+  exit();
+}
@@ -0,0 +1,125 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define NMAX 32
+#define TICKETS 10      // of every worker
+#define BURN 10000      // iterations in a unit of work
+
+// I/O-bound worker: burn a short burst, hand a token to its partner
+// over a pipe and block until it comes back, so it always gives up the
+// CPU long before a tick. The token carries the stop tick.
+static void
+iobound(int first, int in, int out, int go, int done, int burst)
+{
+  struct benchres r;
+  int stop;
+
+  r.tag = 1;
+  r.work = 0;
+  if(settickets(TICKETS, 0) < 0) fail("settickets");
+  stop = benchstop(go);
+  if(first && write(out, &stop, sizeof(stop)) != sizeof(stop)) fail("write token");
+  for(;;){
+    if(read(in, &stop, sizeof(stop)) != sizeof(stop)) fail("read token");
+    if(uptime() >= stop){
+      write(out, &stop, sizeof(stop));    // let the partner see it too
+      break;
+    }
+    for(int i = 0; i < burst; i++){
+      benchspin(BURN);
+      r.work++;
+    }
+    if(write(out, &stop, sizeof(stop)) != sizeof(stop)) fail("write token");
+  }
+  write(done, &r, sizeof(r));
+  exit();
+}
+
+// One run under the given charging mode; prints a row per class.
+static void
+run(int mode, int ticks, int ncpu, int npair, int burst)
+{
+  static char *names[] = { "tick", "exact", "comp" };
+  int go[2], done[2], ab[2], ba[2];
+  int n = ncpu + 2 * npair, i;
+  uint work[2] = { 0, 0 }, total;
+  struct benchres res[NMAX];    // tagged 1 for I/O-bound
+
+  if(schedcharge(mode) < 0) fail("schedcharge");
+  benchpipes(go, done);
+  for(i = 0; i < ncpu; i++)
+    if(benchfork(go, done) == 0)
+      benchworker(0, TICKETS, BURN, go[0], done[1]);
+  for(i = 0; i < npair; i++){
+    if(pipe(ab) < 0 || pipe(ba) < 0) fail("pipe");
+    for(int side = 0; side < 2; side++){
+      if(benchfork(go, done) == 0){
+        if(side == 0)
+          iobound(1, ba[0], ab[1], go[0], done[1], burst);
+        iobound(0, ab[0], ba[1], go[0], done[1], burst);
+      }
+    }
+    close(ab[0]);
+    close(ab[1]);
+    close(ba[0]);
+    close(ba[1]);
+  }
+  benchgo(go, done, n, ticks);
+  total = benchcollect(done[0], res, n);
+  for(i = 0; i < n; i++)
+    work[res[i].tag] += res[i].work;
+  for(i = 0; i < n; i++)
+    wait();
+  close(go[1]);
+  close(done[0]);
+  if(total == 0) fail("no work done");
+
+  // share per process of each class against its ticket share, in
+  // tenths of a percent
+  int want = 1000 / n;
+  if(ncpu > 0){
+    int got = work[0] * 1000 / total / ncpu;
+    printf(1, "%s\tcpu\t%d\t%d.%d%%\t%d.%d%%\n", names[mode], ncpu,
+           got / 10, got % 10, want / 10, want % 10);
+  }
+  if(npair > 0){
+    int got = work[1] * 1000 / total / (2 * npair);
+    printf(1, "%s\tio\t%d\t%d.%d%%\t%d.%d%%\n", names[mode], 2 * npair,
+           got / 10, got % 10, want / 10, want % 10);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ticks = 300;
+  int ncpu = 4;         // CPU-bound workers
+  int npair = 2;        // I/O-bound pairs
+  int burst = 5;        // units per I/O burst
+  int i, old;
+
+  benchinit("chargebench", "[-t ticks] [-c cpu-bound] [-p io-pairs] [-b burst]");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-' || i + 1 >= argc) usage();
+    if(argv[i][1] == 't') ticks = atoi(argv[++i]);
+    else if(argv[i][1] == 'c') ncpu = atoi(argv[++i]);
+    else if(argv[i][1] == 'p') npair = atoi(argv[++i]);
+    else if(argv[i][1] == 'b') burst = atoi(argv[++i]);
+    else usage();
+  }
+  if(ticks <= 0 || ncpu < 0 || npair < 0 || ncpu + 2 * npair == 0 ||
+     ncpu + 2 * npair > NMAX || burst <= 0)
+    usage();
+
+  printf(1, "[chargebench] %d cpu-bound, %d io-bound, %d tickets each, "
+         "burst %d, %d ticks (run with CPUS=1)\n", ncpu, 2 * npair, TICKETS, burst, ticks);
+  printf(1, "[mode]\t[class]\t[procs]\t[share/proc]\t[ticket share]\n");
+  if((old = schedcharge(CHARGE_EXACT)) < 0) fail("schedcharge");
+  run(CHARGE_TICK, ticks, ncpu, npair, burst);
+  run(CHARGE_EXACT, ticks, ncpu, npair, burst);
+  run(CHARGE_COMP, ticks, ncpu, npair, burst);
+  schedcharge(old);
+  exit();
+}
@@ -0,0 +1,99 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define NMAX 64
+
+// Jain's fairness index of x[0..n-1], in thousandths (1000 = all equal)
+static uint
+jain(uint *x, int n)
+{
+  uint s = 0, sq = 0;
+
+  for(int i = 0; i < n; i++){
+    s += x[i];
+    sq += x[i] * x[i];
+  }
+  if(sq == 0)
+    return 0;
+  return (s * s / n) * 1000 / sq;
+}
+
+// Run the workers in class cls, which they inherit from us, and print
+// throughput and fairness.
+static void
+run(char *name, int ticks, int n)
+{
+  int go[2], done[2], i;
+  struct benchres res[NMAX];    // tagged with the worker's tickets
+  uint total, tsum = 0;
+  uint byticket[NMAX], share[NMAX];
+
+  benchpipes(go, done);
+  for(i = 0; i < n; i++){
+    int t = 10 * (1 + i % 4);
+    if(benchfork(go, done) == 0)
+      benchworker(t, t, BENCH_UNIT, go[0], done[1]);
+  }
+  benchgo(go, done, n, ticks);
+  total = benchcollect(done[0], res, n);
+  for(i = 0; i < n; i++){
+    tsum += res[i].tag;
+    wait();
+  }
+  close(go[1]);
+  close(done[0]);
+  if(total == 0) fail("no work done");
+
+  // shares in tenths of a percent; byticket is share over ticket share,
+  // in hundredths, so 100 means exactly proportional
+  int maxerr = 0;
+  for(i = 0; i < n; i++){
+    int got = res[i].work * 1000 / total;
+    int want = res[i].tag * 1000 / tsum;
+    int err = (got - want) * 1000 / want;
+    if(err < 0) err = -err;
+    if(err > maxerr) maxerr = err;
+    share[i] = got;
+    byticket[i] = got * 100 / want;
+  }
+  uint jt = jain(byticket, n), je = jain(share, n);
+  printf(1, "%s\t%d\t%d.%d%%\t0.%d%d%d\t0.%d%d%d\n", name, total / ticks,
+         maxerr / 10, maxerr % 10, jt / 100 % 10, jt / 10 % 10, jt % 10,
+         je / 100 % 10, je / 10 % 10, je % 10);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static char *names[] = {
+    [SCHED_STRIDE] "stride", [SCHED_LOTTERY] "lottery", [SCHED_RR] "rr"
+  };
+  int ticks = 300;
+  int n = 16;           // workers, tickets 10/20/30/40 in turn
+  int global = 0;       // switch every process, not just the workers
+  int cls, old;
+
+  benchinit("classbench", "[-g] [-t ticks] [-n workers]");
+  for(int i = 1; i < argc; i++){
+    if(argv[i][0] != '-') usage();
+    if(argv[i][1] == 'g') global = 1;
+    else if(i + 1 >= argc) usage();
+    else if(argv[i][1] == 't') ticks = atoi(argv[++i]);
+    else if(argv[i][1] == 'n') n = atoi(argv[++i]);
+    else usage();
+  }
+  if(ticks <= 0 || n <= 0 || n > NMAX) usage();
+
+  if((old = setsched(getpid(), SCHED_STRIDE)) < 0) fail("setsched");
+  printf(1, "[classbench] %d workers, tickets 10/20/30/40, %d ticks, %s switch\n",
+         n, ticks, global ? "global" : "per-process");
+  printf(1, "[class]\t[units/tick]\t[worst ticket err]\t[jain by tickets]\t[jain equal]\n");
+  for(cls = SCHED_STRIDE; cls <= SCHED_RR; cls++){
+    if(setsched(global ? 0 : getpid(), cls) < 0) fail("setsched");
+    run(names[cls], ticks, n);
+  }
+  setsched(global ? 0 : getpid(), global ? SCHED_STRIDE : old);
+  exit();
+}
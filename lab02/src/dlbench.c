@@ -0,0 +1,162 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define MAXTASK 8
+#define MAXHOG 16
+#define TICKETS 10      // of every task and hog
+#define BURN 10000      // iterations in a unit of work
+
+struct result {
+  int runtime;    // of the task
+  int period;
+  int jobs;       // jobs released before the stop tick
+  int misses;     // ... that finished after their deadline
+  int kmisses;    // deadlines the kernel saw missed (-1 outside the class)
+};
+
+// units of BURN per tick, measured before anything else runs
+static uint
+calibrate(void)
+{
+  uint n = 0;
+  int start = uptime() + 1;
+
+  while(uptime() < start)
+    ;
+  while(uptime() < start + 10){
+    benchspin(BURN);
+    n++;
+  }
+  return n / 10;
+}
+
+// hog: compete at TICKETS until killed
+static void
+hog(void)
+{
+  if(settickets(TICKETS, 0) < 0) fail("settickets");
+  for(;;)
+    benchspin(BURN);
+}
+
+// Periodic task: every period ticks, release a job of work units, due
+// a period later, and sleep until the next release once it is done.
+// In the deadline class it reserves runtime ticks a period.
+static void
+periodic(int dl, int runtime, int period, uint work, int go, int done)
+{
+  struct result r;
+  struct dlstat st;
+  int stop, release, now;
+
+  r.runtime = runtime;
+  r.period = period;
+  r.jobs = r.misses = 0;
+  r.kmisses = -1;
+  if(settickets(TICKETS, 0) < 0) fail("settickets");
+  stop = benchstop(go);
+  if(dl && setdeadline(runtime, period, 0) < 0) fail("setdeadline: not admitted");
+  for(release = uptime(); release + period <= stop; release += period){
+    if(uptime() >= stop){
+      // still catching up at the stop tick: the rest can only be late
+      r.jobs++;
+      r.misses++;
+      continue;
+    }
+    for(uint u = 0; u < work; u++)
+      benchspin(BURN);
+    r.jobs++;
+    if(uptime() > release + period)
+      r.misses++;
+    if((now = uptime()) < release + period)
+      sleep(release + period - now);
+  }
+  if(dl){
+    if(dlstat(getpid(), &st) < 0) fail("dlstat");
+    r.kmisses = st.misses;
+  }
+  write(done, &r, sizeof(r));
+  exit();
+}
+
+// One run with the tasks in the stride or the deadline class against
+// nhog hogs; prints a row per task.
+static void
+run(int dl, int ticks, int ntask, int *rt, int *per, uint upt, int nhog)
+{
+  int go[2], done[2], hogs[MAXHOG], i;
+  struct result r[MAXTASK];
+
+  for(i = 0; i < nhog; i++){
+    if((hogs[i] = fork()) < 0) fail("fork");
+    if(hogs[i] == 0)
+      hog();
+  }
+  benchpipes(go, done);
+  for(i = 0; i < ntask; i++)
+    if(benchfork(go, done) == 0)
+      // three quarters of the budget, leaving room for the kernel
+      periodic(dl, rt[i], per[i], rt[i] * upt * 3 / 4, go[0], done[1]);
+  benchgo(go, done, ntask, ticks);
+  for(i = 0; i < ntask; i++)
+    benchread(done[0], &r[i], sizeof(r[i]));
+  for(i = 0; i < ntask; i++)
+    wait();
+  for(i = 0; i < nhog; i++)
+    kill(hogs[i]);
+  for(i = 0; i < nhog; i++)
+    wait();
+  close(go[1]);
+  close(done[0]);
+
+  for(i = 0; i < ntask; i++){
+    int rate = r[i].jobs ? r[i].misses * 1000 / r[i].jobs : 0;
+    printf(1, "%s\t%d/%d\t%d\t%d\t%d.%d%%\t", dl ? "deadline" : "stride",
+           r[i].runtime, r[i].period, r[i].jobs, r[i].misses, rate / 10, rate % 10);
+    if(r[i].kmisses < 0)
+      printf(1, "-\n");
+    else
+      printf(1, "%d\n", r[i].kmisses);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ticks = 500;
+  int nhog = 4;
+  int rt[MAXTASK] = { 1, 2, 3 };        // runtime ticks per period
+  int per[MAXTASK] = { 4, 10, 20 };     // period ticks
+  int ntask = 3;
+  int i, n = 0, util = 0;
+
+  benchinit("dlbench", "[-t ticks] [-h hogs] [runtime period]...");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] == '-'){
+      if(i + 1 >= argc) usage();
+      if(argv[i][1] == 't') ticks = atoi(argv[++i]);
+      else if(argv[i][1] == 'h') nhog = atoi(argv[++i]);
+      else usage();
+    } else {
+      if(i + 1 >= argc || n >= MAXTASK) usage();
+      rt[n] = atoi(argv[i]);
+      per[n++] = atoi(argv[++i]);
+      ntask = n;
+    }
+  }
+  if(ticks <= 0 || nhog < 0 || nhog > MAXHOG) usage();
+  for(i = 0; i < ntask; i++){
+    if(rt[i] <= 0 || per[i] < rt[i]) usage();
+    util += rt[i] * 1000 / per[i];
+  }
+
+  uint upt = calibrate();
+  printf(1, "[dlbench] %d periodic tasks, utilization %d.%d%%, against %d hogs, "
+         "%d ticks (run with CPUS=1)\n", ntask, util / 10, util % 10, nhog, ticks);
+  printf(1, "[class]\t[runtime/period]\t[jobs]\t[missed]\t[miss rate]\t[kernel misses]\n");
+  run(0, ticks, ntask, rt, per, upt, nhog);
+  run(1, ticks, ntask, rt, per, upt, nhog);
+  exit();
+}
@@ -0,0 +1,57 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define NMAX 64
+
+int
+main(int argc, char *argv[])
+{
+  int ticks = 300;
+  int n = 16;           // workers, tickets 10/20/30/40 in turn
+  int go[2], done[2];
+  struct benchres res[NMAX];    // tagged with the worker's tickets
+  uint total, tsum = 0;
+  int i;
+
+  benchinit("fairbench", "[-t ticks] [-n workers]");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-' || i + 1 >= argc) usage();
+    if(argv[i][1] == 't') ticks = atoi(argv[++i]);
+    else if(argv[i][1] == 'n') n = atoi(argv[++i]);
+    else usage();
+  }
+  if(ticks <= 0 || n <= 0 || n > NMAX) usage();
+
+  benchpipes(go, done);
+  for(i = 0; i < n; i++){
+    int t = 10 * (1 + i % 4);
+    if(benchfork(go, done) == 0)
+      benchworker(t, t, BENCH_UNIT, go[0], done[1]);
+  }
+  benchgo(go, done, n, ticks);
+  total = benchcollect(done[0], res, n);
+  for(i = 0; i < n; i++){
+    tsum += res[i].tag;
+    wait();
+  }
+  if(total == 0) fail("no work done");
+
+  // achieved share vs. ticket share, in tenths of a percent
+  int maxerr = 0;
+  printf(1, "[fairbench] %d workers, %d ticks (run once per CPUS=1..8)\n", n, ticks);
+  printf(1, "[tickets]\t[work]\t[share]\t[expected]\n");
+  for(i = 0; i < n; i++){
+    int got = res[i].work * 1000 / total;
+    int want = res[i].tag * 1000 / tsum;
+    int err = (got - want) * 1000 / want;
+    if(err < 0) err = -err;
+    if(err > maxerr) maxerr = err;
+    printf(1, "%d\t%d\t%d.%d%%\t%d.%d%%\n", res[i].tag, res[i].work,
+           got / 10, got % 10, want / 10, want % 10);
+  }
+  printf(1, "throughput: %d units/tick, worst share error: %d.%d%% of target\n",
+         total / ticks, maxerr / 10, maxerr % 10);
+  exit();
+}
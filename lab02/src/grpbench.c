@@ -0,0 +1,95 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define MAXGRP 7        // NGROUP less the default group
+#define MAXPROC 64
+
+// leader: join the group, fork the other members, which inherit it,
+// and work as its last member
+static void
+leader(int group, int gid, int members, int go, int done)
+{
+  if(setgroup(getpid(), gid) < 0) fail("setgroup");
+  for(int i = 1; i < members; i++){
+    int pid = fork();
+    if(pid < 0) fail("fork");
+    if(pid == 0)
+      benchworker(group, 10, BENCH_UNIT, go, done);
+  }
+  benchworker(group, 10, BENCH_UNIT, go, done);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ticks = 300;
+  int members[MAXGRP], tickets[MAXGRP];
+  uint work[MAXGRP];
+  int ngrp = 0, nproc = 0;
+  int go[2], done[2];
+  struct benchres res[MAXPROC]; // tagged with the member's group
+  uint total, tsum = 0;
+  int i;
+
+  benchinit("grpbench", "[-t ticks] [members...]");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] == '-'){
+      if(argv[i][1] != 't' || i + 1 >= argc) usage();
+      ticks = atoi(argv[++i]);
+    } else {
+      if(ngrp == MAXGRP) usage();
+      members[ngrp++] = atoi(argv[i]);
+    }
+  }
+  if(ngrp == 0){
+    // one job of a single process against ever larger ones
+    members[0] = 1;
+    members[1] = 8;
+    members[2] = 32;
+    ngrp = 3;
+  }
+  for(i = 0; i < ngrp; i++){
+    if(members[i] <= 0) usage();
+    nproc += members[i];
+  }
+  if(ticks <= 0 || nproc > MAXPROC) usage();
+
+  // equal tickets for every group but the last, which gets twice as many
+  benchpipes(go, done);
+  for(i = 0; i < ngrp; i++){
+    tickets[i] = i == ngrp - 1 && ngrp > 1 ? 200 : 100;
+    work[i] = 0;
+    tsum += tickets[i];
+    int gid = grpcreate(tickets[i]);
+    if(gid < 0) fail("grpcreate");
+    if(benchfork(go, done) == 0)
+      leader(i, gid, members[i], go[0], done[1]);
+  }
+  benchgo(go, done, nproc, ticks);
+  total = benchcollect(done[0], res, nproc);
+  for(i = 0; i < nproc; i++)
+    work[res[i].tag] += res[i].work;
+  for(i = 0; i < ngrp; i++)     // members were forked by their leaders
+    wait();
+  if(total == 0) fail("no work done");
+
+  // achieved share vs. group ticket share, and what flat per-process
+  // tickets would have given, in tenths of a percent
+  int maxerr = 0;
+  printf(1, "[grpbench] %d groups, %d processes, %d ticks\n", ngrp, nproc, ticks);
+  printf(1, "[members]\t[tickets]\t[work]\t[share]\t[expected]\t[flat]\n");
+  for(i = 0; i < ngrp; i++){
+    int got = work[i] * 1000 / total;
+    int want = tickets[i] * 1000 / tsum;
+    int flat = members[i] * 1000 / nproc;
+    int err = (got - want) * 1000 / want;
+    if(err < 0) err = -err;
+    if(err > maxerr) maxerr = err;
+    printf(1, "%d\t%d\t%d\t%d.%d%%\t%d.%d%%\t%d.%d%%\n", members[i], tickets[i],
+           work[i], got / 10, got % 10, want / 10, want % 10, flat / 10, flat % 10);
+  }
+  printf(1, "worst share error: %d.%d%% of target\n", maxerr / 10, maxerr % 10);
+  exit();
+}
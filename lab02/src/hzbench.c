@@ -0,0 +1,172 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+// x tenths as a decimal
+static void
+printtenths(uint x)
+{
+  printf(1, "%d.%d", x / 10, x % 10);
+}
+
+struct result {
+  uint us;        // microseconds the worker ran for, start to finish
+  uint runs;      // stretches it ran without being switched out
+  uint runus;     // ... and their total length
+};
+
+// Wait for a tick to begin; return it.
+static int
+tickedge(void)
+{
+  int t = uptime();
+
+  while(uptime() == t)
+    ;
+  return t + 1;
+}
+
+// The clock over ticks ticks: microseconds counted, and times it went back.
+static void
+clockcheck(int ticks, struct timerinfo *ti)
+{
+  uint t0, t1, now, last, back = 0;
+  int stop = tickedge() + ticks;
+
+  t0 = last = uptime_us();
+  while(uptime() < stop){
+    if((now = uptime_us()) < last)
+      back++;
+    last = now;
+  }
+  t1 = uptime_us();
+  printf(1, "clock\t%d ticks\t%d us\t(%d expected)\t%d steps back\n",
+         ticks, t1 - t0, ticks * ti->uspertick, back);
+}
+
+// switcher: yield n times on CPU 0 with whatever else runs there
+static void
+switcher(int n, int go, int done)
+{
+  struct result r;
+
+  if(setaffinity(getpid(), 1) < 0) fail("setaffinity");
+  benchstop(go);        // released with the others; n, not the tick, ends it
+  r.us = uptime_us();
+  for(int i = 0; i < n; i++)
+    yield();
+  r.us = uptime_us() - r.us;
+  r.runs = r.runus = 0;
+  write(done, &r, sizeof(r));
+  exit();
+}
+
+// hog: spin on CPU 0 until the stop tick, timing the stretches between
+// gaps of at least gap microseconds, which are other processes' turns
+static void
+hog(uint gap, int go, int done)
+{
+  struct result r;
+  uint start, last, now;
+  int stop;
+
+  if(setaffinity(getpid(), 1) < 0) fail("setaffinity");
+  stop = benchstop(go);
+  r.runs = r.runus = 0;
+  r.us = start = last = uptime_us();
+  while(uptime() < stop){
+    now = uptime_us();
+    if(now - last >= gap){
+      r.runs++;
+      r.runus += last - start;
+      start = now;
+    }
+    last = now;
+  }
+  r.us = last - r.us;
+  write(done, &r, sizeof(r));
+  exit();
+}
+
+// Start nproc copies of the switcher (n yields) or, with n == 0, of the
+// hog for ticks ticks, all on CPU 0, and add up their results.
+static void
+run(int nproc, int n, int ticks, uint gap, struct result *sum)
+{
+  int go[2], done[2], i;
+  struct result r;
+
+  benchpipes(go, done);
+  for(i = 0; i < nproc; i++){
+    if(benchfork(go, done) == 0){
+      if(n > 0)
+        switcher(n, go[0], done[1]);
+      hog(gap, go[0], done[1]);
+    }
+  }
+
+  sleep(2);     // let them all settle on CPU 0
+  benchgo(go, done, nproc, ticks);
+  sum->us = sum->runs = sum->runus = 0;
+  for(i = 0; i < nproc; i++){
+    benchread(done[0], &r, sizeof(r));
+    if(r.us > sum->us)
+      sum->us = r.us;
+    sum->runs += r.runs;
+    sum->runus += r.runus;
+  }
+  for(i = 0; i < nproc; i++)
+    wait();
+  close(go[1]);
+  close(done[0]);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct timerinfo ti;
+  struct result one, two, q;
+  int ticks = 200;
+  int n = 10000;        // yields per switcher
+  int i;
+
+  benchinit("hzbench", "[-t ticks] [-n yields]");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-' || i + 1 >= argc) usage();
+    if(argv[i][1] == 't') ticks = atoi(argv[++i]);
+    else if(argv[i][1] == 'n') n = atoi(argv[++i]);
+    else usage();
+  }
+  if(ticks <= 0 || n <= 0) usage();
+  if(timerinfo(&ti) < 0) fail("timerinfo");
+
+  // The LAPIC timer counts at bus frequency / 8.
+  printf(1, "[hzbench] HZ %d, %d us a tick, LAPIC bus %d MHz, TSC %d MHz, "
+         "dynamic ticks %s\n", ti.hz, ti.uspertick, ti.lapicpertick * ti.hz / 125000,
+         ti.tscpertick / ti.uspertick, ti.tickless ? "on" : "off");
+  clockcheck(ticks, &ti);
+
+  // A lone yield returns straight to its caller through the scheduler;
+  // two on one CPU switch to each other every time.
+  run(1, n, 0, 0, &one);
+  run(2, n, 0, 0, &two);
+  uint yieldus = one.us * 10 / n;           // tenths of a microsecond
+  uint switchus = two.us * 10 / (2 * n);
+  printf(1, "yield\t");
+  printtenths(yieldus);
+  printf(1, " us alone\t");
+  printtenths(switchus);
+  printf(1, " us switching\n");
+
+  // Two hogs share CPU 0 a quantum at a time; a gap of an eighth of a
+  // tick or more is the other one's turn rather than an interrupt.
+  run(2, 0, ticks, ti.uspertick / 8, &q);
+  if(q.runs == 0) fail("hogs never switched");
+  uint quantum = q.runus / q.runs;
+  uint overhead = switchus * 100 / (quantum + switchus / 10);   // thousandths
+  printf(1, "quantum\t%d us measured\t%d switches\toverhead ", quantum, q.runs);
+  printtenths(overhead);
+  printf(1, "%%\n");
+  exit();
+}
@@ -0,0 +1,93 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define MAXCPU 8
+
+// spin until the stop tick
+static void
+spin(int stop)
+{
+  while(uptime() < stop)
+    benchspin(BENCH_UNIT);
+  exit();
+}
+
+// rate of n events in us microseconds, per second
+static uint
+persec(uint n, uint us)
+{
+  us /= 1000;
+  return us ? n * 1000 / us : 0;
+}
+
+// One run of ticks ticks with busy spinning processes and dynamic ticks
+// on or off; prints a row per CPU.
+static void
+run(int tickless, int busy, int ticks)
+{
+  struct cpustat before[MAXCPU], after[MAXCPU];
+  int i, n;
+  uint us;
+
+  if(settickless(tickless) < 0) fail("settickless");
+  sleep(2);             // let every CPU's timer see the change
+  int stop = uptime() + ticks;
+  us = uptime_us();
+  if((n = cpustat(before, MAXCPU)) < 0) fail("cpustat");
+  for(i = 0; i < busy; i++){
+    int pid = fork();
+    if(pid < 0) fail("fork");
+    if(pid == 0)
+      spin(stop);
+  }
+  for(i = 0; i < busy; i++)
+    wait();
+  if(uptime() < stop)
+    sleep(stop - uptime());
+  if(cpustat(after, MAXCPU) != n) fail("cpustat");
+  us = uptime_us() - us;
+  if(n > MAXCPU) n = MAXCPU;
+
+  for(i = 0; i < n; i++){
+    printf(1, "%s\t%d\t%d\t%d\t%d\t%d\t%d\n", tickless ? "on" : "off", busy, i,
+           persec(after[i].ticks - before[i].ticks, us),
+           persec(after[i].ipis - before[i].ipis, us),
+           persec(after[i].halts - before[i].halts, us),
+           persec(after[i].locks - before[i].locks, us));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpustat cs[MAXCPU];
+  int ticks = 200;
+  int busy = 1;         // busy processes
+  int i, old;
+
+  benchinit("idlebench", "[-t ticks] [-b busy]");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-' || i + 1 >= argc) usage();
+    if(argv[i][1] == 't') ticks = atoi(argv[++i]);
+    else if(argv[i][1] == 'b') busy = atoi(argv[++i]);
+    else usage();
+  }
+  if(ticks <= 0 || busy < 0) usage();
+  if((old = settickless(-1)) < 0) fail("settickless");
+
+  // Idle, then with the busy processes, with a timer interrupt every
+  // tick and then with dynamic ticks.
+  printf(1, "[idlebench] idle and %d busy process(es), %d ticks, %d CPUs\n",
+         busy, ticks, cpustat(cs, MAXCPU));
+  printf(1, "watch host CPU usage of the QEMU process (e.g. top) while this runs\n");
+  printf(1, "[dynamic ticks]\t[busy]\t[cpu]\t[timer irqs/s]\t[ipis/s]\t[halts/s]\t[locks/s]\n");
+  for(int on = 0; on <= 1; on++){
+    run(on, 0, ticks);
+    if(busy > 0)
+      run(on, busy, ticks);
+  }
+  settickless(old);
+  exit();
+}
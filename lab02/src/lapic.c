@@ -42,6 +42,22 @@
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
 volatile uint *lapic;  // Initialized in mp.c
+uint lapicpertick;     // Timer counts per tick, calibrated by the boot CPU
+uint tscpertick;       // Time stamp counter cycles per tick, likewise
+
+// The 8254 PIT, used only as a known clock to calibrate the timer against.
+#define PIT_HZ       1193182   // PIT input clock
+#define PIT_CH2      0x42      // Channel 2 data
+#define PIT_MODE     0x43      // Mode/command
+#define PIT_GATE     0x61      // Channel 2 gate (bit 0) and output (bit 5)
+#define CAL_MS       50        // Calibration time in milliseconds
+
+#if CAL_MS * HZ < 1000
+#error "HZ must give at least one tick in CAL_MS"
+#endif
+#if 1000000 % HZ != 0
+#error "HZ must divide 1000000 for USPERTICK to be exact"
+#endif
 
 //PAGEBREAK!
 static void
@@ -51,6 +67,39 @@ lapicw(int index, int value)
   lapic[ID];  // wait for write to finish, by reading
 }
 
+// Count how far the timer and the time stamp counter get in CAL_MS
+// milliseconds of PIT channel 2, counting down once from its start with
+// the speaker off, and set lapicpertick for HZ interrupts a second and
+// tscpertick to match. The timer must be masked and its divider set.
+static void
+lapiccalibrate(void)
+{
+  uint n = PIT_HZ * CAL_MS / 1000, c, tsc;
+
+  outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);
+  outb(PIT_MODE, 0xB0);      // channel 2, low then high byte, mode 0
+  outb(PIT_CH2, n & 0xFF);
+  lapicw(TICR, 0xFFFFFFFF);
+  tsc = rdtsc_lo();
+  outb(PIT_CH2, n >> 8);     // the PIT starts counting
+  while(!(inb(PIT_GATE) & 0x20) && lapic[TCCR] != 0)
+    ;
+  c = 0xFFFFFFFF - lapic[TCCR];
+  tsc = rdtsc_lo() - tsc;
+  lapicw(TICR, 0);
+
+  // x * 1000 / (CAL_MS * HZ), in two parts: scaling up to a second
+  // overflows for a TSC above 4.29 GHz, and dividing by a whole number
+  // of ticks in CAL_MS drops the fraction of one.
+  lapicpertick = c / (CAL_MS * HZ) * 1000 + c % (CAL_MS * HZ) * 1000 / (CAL_MS * HZ);
+  tscpertick = tsc / (CAL_MS * HZ) * 1000 + tsc % (CAL_MS * HZ) * 1000 / (CAL_MS * HZ);
+  if(lapicpertick == 0 || tscpertick == 0){
+    // no PIT to speak of: the old fixed count at HZ 100, and a 1 GHz guess
+    lapicpertick = 2000000000 / HZ;
+    tscpertick = 1000000000 / HZ;
+  }
+}
+
 void
 lapicinit(void)
 {
@@ -60,13 +109,18 @@ lapicinit(void)
   // Enable local APIC; set spurious interrupt vector.
   lapicw(SVR, ENABLE | (T_IRQ0 + IRQ_SPURIOUS));
 
-  // The timer repeatedly counts down at bus frequency
-  // from lapic[TICR] and then issues an interrupt.
-  // If xv6 cared more about precise timekeeping,
-  // TICR would be calibrated using an external time source.
+  // The timer counts down once at bus frequency / 8
+  // from lapic[TICR] and then issues an interrupt;
+  // sched_timer() arms it again for the next one.
+  // The boot CPU calibrates TICR against the PIT for HZ
+  // interrupts a second; the others start after it.
   lapicw(TDCR, 0x2);         // divide by 8
-  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 20000000);   // initial count
+  if(lapicpertick == 0){
+    lapicw(TIMER, MASKED);
+    lapiccalibrate();
+  }
+  lapicw(TIMER, T_IRQ0 + IRQ_TIMER);
+  lapicw(TICR, lapicpertick);   // first tick
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -97,6 +151,27 @@ lapicinit(void)
   lapicw(TPR, 0);
 }
 
+// Arm this CPU's timer to interrupt once, n ticks from now, or as
+// many as the 32-bit count holds.
+void
+lapictimer(uint n)
+{
+  if(!lapic)
+    return;
+  if(n > 0xFFFFFFFF / lapicpertick)
+    n = 0xFFFFFFFF / lapicpertick;
+  lapicw(TICR, n * lapicpertick);
+}
+
+// Counts left before this CPU's timer goes off, 0 if it is not armed.
+uint
+lapictimerleft(void)
+{
+  if(!lapic)
+    return 0;
+  return lapic[TCCR];
+}
+
 int
 lapicid(void)
 {
@@ -113,6 +188,19 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+// Send interrupt vector to the CPU with APIC ID apicid.
+// Interrupts must be off so the ICR writes are not interleaved.
+void
+lapicipi(int apicid, int vector)
+{
+  if(!lapic)
+    return;
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
@@ -0,0 +1,19 @@
+#define NPROC      1024  // maximum number of processes
+#define KSTACKSIZE 4096  // size of per-process kernel stack
+#define NCPU          8  // maximum number of CPU
+#define NGROUP        8  // maximum number of scheduling groups
+#define NOFILE       16  // open files per process
+#define NFILE       100  // open files per system
+#define NINODE       50  // maximum number of active i-nodes
+#define NDEV         10  // maximum major device number
+#define ROOTDEV       1  // device number of file system root disk
+#define MAXARG       32  // max exec arguments
+#define MAXOPBLOCKS  10  // max # of blocks any FS op writes
+#define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
+#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
+#define FSSIZE       1000  // size of file system in blocks
+#ifndef HZ
+#define HZ         100  // timer interrupts per second (make HZ=...), divides 1000000
+#endif
+#define USPERTICK    (1000000/HZ)  // microseconds per tick
+#define TICKLESSMAX  (HZ/2)  // longest a CPU's timer is stopped, in ticks
@@ -6,12 +6,70 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "sclass.h"
+#include "traps.h"
+#include "schedtrace.h"
+
+// Sleeping processes are hashed by chan so wakeup() only looks at
+// processes that may be sleeping on it.
+#define NSLEEPQ 64
+#define SLEEPQ(chan) (((uint)(chan) >> 3) % NSLEEPQ)
 
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
+  struct proc *sleepq[NSLEEPQ]; // SLEEPING processes by chan
+  struct group group[NGROUP];   // Scheduling groups, 0 is the default
 } ptable;
 
+// Per-CPU run queues. Each CPU runs its own RUNNABLE processes. A
+// queue's lock is the lock held across a context switch: a process calls
+// sched() holding the queue lock of the CPU it runs on, and that CPU's
+// scheduler releases it. ptable.lock still guards the table and
+// sleep/wakeup, and is taken before any queue lock.
+//
+// An idle CPU steals the next process of the busiest queue, and
+// every BALANCE_TICKS each CPU pulls from the most loaded queue while a
+// move narrows the ticket-load gap. A process moves only if its tickets
+// are below the gap, so once balanced no queue exceeds another by more
+// than the tickets of its lowest-pass process; within a queue the stride
+// bound is unchanged, and a process's share of all CPUs is off its ticket
+// share by at most that gap over its queue's load.
+//
+// Loads count a process at its share of its group's tickets (see
+// sched_weight), so balancing spreads groups, not process counts. Which
+// queued process runs next is up to its scheduler class (sclass.h);
+// deadline class processes stay on their CPU and are never moved.
+//
+// Neither stealing nor balancing moves a process to a CPU outside its
+// affinity, or one that is cache-warm where it is queued: that last ran
+// on that CPU and has waited there less than MIGRATE_WAIT ticks, so its
+// turn is near. A process that must leave its CPU because its affinity
+// changed goes to the least loaded CPU it may run on.
+#define BALANCE_TICKS 10
+#define BALANCE_BATCH 8
+#define MIGRATE_WAIT 2
+
+static struct runq runqs[NCPU];
+
+// How a running process is charged (CHARGE_*, see schedcharge)
+static int chargemode = CHARGE_EXACT;
+
+// Dynamic ticks (see settickless): a CPU with nothing queued stops its
+// timer for up to TICKLESSMAX ticks rather than take an interrupt every
+// tick, when it is idle with nothing to steal, or runs a process outside
+// the deadline class, whose budget is charged a tick at a time.
+static int tickless = 1;
+
+// Low half of the time stamp counter
+uint
+rdtsc_lo(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return lo;
+}
+
 static struct proc *initproc;
 
 int nextpid = 1;
@@ -19,11 +77,24 @@ extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static void runq_wake(struct proc *p);
+static void group_put(int gid);
+static void unlend(struct proc *p);
+static void restride(struct proc *p);
+static int dl_util(int runtime, int period);
+static struct runq* lockrq(void);
 
 void
 pinit(void)
 {
   initlock(&ptable.lock, "ptable");
+  for(int i = 0; i < NCPU; i++){
+    initlock(&runqs[i].lock, "runq");
+    for(int j = 0; j < NGROUP; j++)
+      runqs[i].gq[j].gidx = -1;
+  }
+  ptable.group[0].tickets = GROUP_TICKETS;
+  ptable.group[0].stride = STRIDE_MAX / GROUP_TICKETS;
 }
 
 // Must be called with interrupts disabled
@@ -95,6 +166,27 @@ found:
   p->pass = 0;
   p->ticks = 0;
   p->end_ticks = -1;
+  p->rqidx = -1;
+  p->cpu = 0;
+  p->oncpu = 0;
+  p->sqnext = 0;
+  p->sqprev = 0;
+  p->group = 0;
+  p->weight = 0;
+  p->lent = 0;
+  p->lendto = 0;
+  p->comp = 0;
+  p->sclass = SCHED_STRIDE;
+  p->rqnext = 0;
+  p->rqprev = 0;
+  p->dlruntime = 0;
+  p->dlperiod = 0;
+  p->dlmisses = 0;
+  p->affinity = ~0;
+  p->lastcpu = -1;
+  p->nmigrate = 0;
+  p->yielded = 0;
+  memset(&p->stat, 0, sizeof(p->stat));
 
   release(&ptable.lock);
 
@@ -155,7 +247,9 @@ userinit(void)
   // because the assignment might not be atomic.
   acquire(&ptable.lock);
 
-  p->state = RUNNABLE;
+  p->cpu = 0;
+  ptable.group[0].nproc++;
+  runq_wake(p);
 
   release(&ptable.lock);
 }
@@ -221,11 +315,16 @@ fork(void)
 
   acquire(&ptable.lock);
 
-  np->state = RUNNABLE;
+  np->cpu = cpuid();
+  np->affinity = curproc->affinity;
+  np->group = curproc->group;
+  // A reservation is not inherited.
+  np->sclass = curproc->sclass == SCHED_DEADLINE ? SCHED_STRIDE : curproc->sclass;
+  ptable.group[np->group].nproc++;
+  runq_wake(np);
 
-  // Debug log for scheduler test at the start of process
-  if(np->pid > 2 && curproc && curproc->pid > 2)
-    cprintf("Process %d start\n", np->pid);
+  // Trace for scheduler test at the start of process
+  schedtr_record(SCHEDEV_FORK, np, 0);
 
   release(&ptable.lock);
 
@@ -272,12 +371,21 @@ exit(void)
     }
   }
 
-  // Debug log for scheduler test at the end of process
-  if(curproc->pid > 2 && curproc->parent && curproc->parent->pid > 2)
-    cprintf("Process %d exit\n", curproc->pid);
+  // Trace for scheduler test at the end of process
+  schedtr_record(SCHEDEV_EXIT, curproc, 0);
+
+  // Leave the scheduling group.
+  ptable.group[curproc->group].load -= curproc->tickets;
+  group_put(curproc->group);
+
+  // Give back its reservation.
+  if(curproc->sclass == SCHED_DEADLINE)
+    runqs[curproc->cpu].dlutil -= dl_util(curproc->dlruntime, curproc->dlperiod);
 
   // Jump into the scheduler, never to return.
   curproc->state = ZOMBIE;
+  lockrq();
+  release(&ptable.lock);
   sched();
   panic("zombie exit");
 }
@@ -287,7 +395,7 @@ exit(void)
 int
 wait(void)
 {
-  struct proc *p;
+  struct proc *p, *live;
   int havekids, pid;
   struct proc *curproc = myproc();
   
@@ -295,12 +403,17 @@ wait(void)
   for(;;){
     // Scan through table looking for exited children.
     havekids = 0;
+    live = 0;
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
       if(p->parent != curproc)
         continue;
       havekids = 1;
+      if(p->state != ZOMBIE && live == 0)
+        live = p;
       if(p->state == ZOMBIE){
-        // Found one.
+        // Found one. It may still be switching away on its CPU.
+        while(p->oncpu)
+          ;
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
@@ -321,42 +434,496 @@ wait(void)
       return -1;
     }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-    sleep(curproc, &ptable.lock);  //DOC: wait-sleep
+    // Wait for children to exit, lending our tickets to one of them.
+    // (See wakeup1 call in proc_exit.)
+    sleepfor(curproc, &ptable.lock, live, live->pid);  //DOC: wait-sleep
   }
 }
 
+// p's share of its group's tickets, in 1/1024 tickets, so that the
+// members of a group weigh as much together as the group's tickets.
+// Loads are read without the ptable lock; a stale one only skews the
+// balancing, which is what weights are for.
+static int
+sched_weight(struct proc *p)
+{
+  struct group *g = &ptable.group[p->group];
+  uint r = 1024;
+
+  if(g->load > p->tickets)
+    r = ((uint)p->tickets << 10) / g->load;
+  return g->tickets * r;
+}
+
+// Count p, about to be queued on rq as RUNNABLE. A process that was
+// RUNNABLE already, being moved, keeps the time it was queued.
 static void
-rebase_pass(void){
+runq_count(struct runq *rq, struct proc *p)
+{
+  if(p->state != RUNNABLE){
+    p->state = RUNNABLE;
+    p->qtick = ticks;
+    p->tscq = rdtsc_lo();
+  }
+  p->weight = sched_weight(p);
+  rq->load += p->weight;
+  rq->n++;
+}
+
+// Make p RUNNABLE and queue it on rq, whose lock must be held.
+static void
+runq_add(struct runq *rq, struct proc *p)
+{
+  runq_count(rq, p);
+  sched_classes[p->sclass]->enqueue(rq, p);
+}
+
+// Take p off rq, whose lock must be held, leaving its state alone.
+static void
+runq_del(struct runq *rq, struct proc *p)
+{
+  sched_classes[p->sclass]->dequeue(rq, p);
+  rq->n--;
+  rq->load -= p->weight;
+}
+
+// Take the next process to run off rq, whose lock must be held, from
+// the first class with anything queued, or return 0 if rq is empty.
+static struct proc*
+runq_pop(struct runq *rq)
+{
   struct proc *p;
-  int flag = 0;     // Flag to check if any process has to rebase
-  
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == RUNNABLE && p->pass > PASS_MAX){
-      flag = 1;     // set flag to rebase
-      break;
+
+  if(rq->n == 0)
+    return 0;
+  for(int i = 0; i < NSCHED; i++){
+    if((p = sched_classes[i]->pick_next(rq)) != 0){
+      rq->n--;
+      rq->load -= p->weight;
+      return p;
     }
   }
-  if(!flag) return;   // No process has to rebase
+  panic("runq_pop");
+}
 
-  uint mn = (uint)-1;   // Minimum pass value among
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    // Find minimum pass value
-    if(p->state == RUNNABLE && p->pass < mn) mn = p->pass;
+// The process runq_pop() would take among those that may move to
+// another CPU, left queued.
+static struct proc*
+runq_peek(struct runq *rq)
+{
+  struct proc *p;
+
+  for(int i = 0; i < NSCHED; i++)
+    if(!sched_classes[i]->pinned && (p = sched_classes[i]->peek(rq)) != 0)
+      return p;
+  return 0;
+}
+
+// Finish moving p, taken off another CPU's queue and detached from it,
+// to rq, whose lock must be held.
+static void
+runq_move(struct runq *rq, struct proc *p)
+{
+  struct sched_class *cls = sched_classes[p->sclass];
+
+  p->cpu = rq - runqs;
+  p->nmigrate++;
+  if(cls->attach)
+    cls->attach(rq, p);
+}
+
+// Get a halted CPU to pick up work just queued on rq: rq's own CPU,
+// or if that one is busy, any halted CPU, which will steal it. A busy
+// CPU with its timer stopped is made to tick again, for the quantum
+// (see sched_timer). Interrupts must be off.
+static void
+runq_kick(struct runq *rq)
+{
+  struct runq *q, *self = &runqs[cpuid()];
+  struct cpu *c = &cpus[rq - runqs];
+
+  if(rq->idle){
+    if(rq != self)
+      lapicipi(c->apicid, T_RESCHED);
+    return;
+  }
+  __sync_synchronize();
+  if((int)(c->timerat - ticks) > 1){
+    if(rq == self)
+      sched_timer(1);
+    else
+      lapicipi(c->apicid, T_RESCHED);
+  }
+  for(q = runqs; q < &runqs[ncpu]; q++){
+    if(q != self && q->idle){
+      lapicipi(cpus[q - runqs].apicid, T_RESCHED);
+      return;
+    }
   }
-  if(mn == (uint)-1) return;   // No RUNNABLE process
+}
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    // Only consider RUNNABLE processes
-    if(p->state != RUNNABLE) continue;
-
-    // Rebase pass values
-    if(p->pass <= mn) p->pass = 0;
-    else if(p->pass > mn){
-      p->pass -= mn;
-      if(p->pass > DISTANCE_MAX) p->pass = DISTANCE_MAX;
+// Get rq's CPU to switch to the deadline process just queued on it if
+// it is running a process of another class, rather than at its next
+// tick (see trap). The running process is read without a lock; a stale
+// one costs a needless switch or a tick's delay. Interrupts must be off.
+static void
+runq_preempt(struct runq *rq)
+{
+  struct proc *cur = cpus[rq - runqs].proc;
+
+  if(rq != &runqs[cpuid()] && cur != 0 && cur->sclass != SCHED_DEADLINE)
+    lapicipi(cpus[rq - runqs].apicid, T_RESCHED);
+}
+
+// May p run on rq's CPU?
+static int
+runq_allowed(struct runq *rq, struct proc *p)
+{
+  return (p->affinity >> (rq - runqs)) & 1;
+}
+
+// Would p rather stay queued on src than move to rq? It would if its
+// affinity keeps it off rq, or if it is cache-warm on src.
+static int
+runq_stay(struct runq *src, struct runq *rq, struct proc *p)
+{
+  return !runq_allowed(rq, p) ||
+         (p->lastcpu == src - runqs && ticks - p->qtick < MIGRATE_WAIT);
+}
+
+// The least loaded queue of the CPUs p may run on. Loads are read
+// without locks, as in runq_busiest().
+static struct runq*
+runq_home(struct proc *p)
+{
+  struct runq *q, *rq = 0;
+
+  for(q = runqs; q < &runqs[ncpu]; q++)
+    if(runq_allowed(q, p) &&
+       (rq == 0 || q->load + q->running < rq->load + rq->running))
+      rq = q;
+  return rq;
+}
+
+// Queue RUNNABLE p, taken off its CPU's queue and detached from it, on
+// the least loaded CPU it may run on. No queue lock may be held.
+static void
+runq_push(struct proc *p)
+{
+  struct runq *rq = runq_home(p);
+
+  acquire(&rq->lock);
+  runq_move(rq, p);
+  runq_add(rq, p);
+  runq_kick(rq);
+  release(&rq->lock);
+}
+
+// Queue p on the CPU it last ran on, or if its affinity no longer
+// allows that CPU, on the least loaded one it does. It may still be
+// switching out on its old CPU; moving waits for that, as wait() does.
+// The ptable lock must be held.
+static void
+runq_wake(struct proc *p)
+{
+  struct runq *rq = &runqs[p->cpu];
+  struct sched_class *cls = sched_classes[p->sclass];
+
+  unlend(p);
+  ptable.group[p->group].load += p->tickets;
+  if(!runq_allowed(rq, p)){
+    while(p->oncpu)
+      ;
+    if(cls->detach){
+      acquire(&rq->lock);
+      cls->detach(rq, p);
+      release(&rq->lock);
     }
+    rq = runq_home(p);
+    acquire(&rq->lock);
+    runq_move(rq, p);
+  } else
+    acquire(&rq->lock);
+  runq_add(rq, p);
+  release(&rq->lock);
+  runq_kick(rq);
+  if(p->sclass == SCHED_DEADLINE)
+    runq_preempt(rq);
+}
+
+// Lock and return the run queue of this CPU.
+static struct runq*
+lockrq(void)
+{
+  struct runq *rq;
+
+  pushcli();
+  rq = &runqs[cpuid()];
+  acquire(&rq->lock);
+  popcli();
+  return rq;
+}
+
+// Release the run queue lock of this CPU.
+static void
+unlockrq(void)
+{
+  release(&runqs[cpuid()].lock);
+}
+
+// The other queue with the most ticket load that has something queued.
+// Loads are read without locks; a stale one only misdirects one attempt.
+static struct runq*
+runq_busiest(struct runq *rq)
+{
+  struct runq *q, *src = 0;
+
+  for(q = runqs; q < &runqs[ncpu]; q++)
+    if(q != rq && q->n > 0 &&
+       (src == 0 || q->load + q->running > src->load + src->running))
+      src = q;
+  return src;
+}
+
+// Take the next process that may move off the busiest other queue for
+// idle rq, or return 0 if there is nothing to steal. No queue lock may
+// be held; the caller finishes the move with runq_move() under rq's lock.
+static struct proc*
+runq_steal(struct runq *rq)
+{
+  struct runq *src = runq_busiest(rq);
+  struct proc *p;
+
+  if(src == 0)
+    return 0;
+  acquire(&src->lock);
+  cpus[rq - runqs].nlock++;
+  if((p = runq_peek(src)) != 0 && runq_stay(src, rq, p))
+    p = 0;
+  if(p != 0){
+    runq_del(src, p);
+    if(sched_classes[p->sclass]->detach)
+      sched_classes[p->sclass]->detach(src, p);
   }
+  release(&src->lock);
+  return p;
+}
+
+// Pull processes from the most loaded queue to rq while each move
+// narrows the ticket-load gap. No queue lock may be held.
+static void
+runq_balance(struct runq *rq)
+{
+  struct proc *moved[BALANCE_BATCH], *p;
+  struct runq *src = runq_busiest(rq);
+  int i, n = 0, gap;
+
+  if(src == 0)
+    return;
+  acquire(&src->lock);
+  cpus[rq - runqs].nlock++;
+  gap = (src->load + src->running) - (rq->load + rq->running);
+  while(n < BALANCE_BATCH && (p = runq_peek(src)) != 0 && p->weight < gap &&
+        !runq_stay(src, rq, p)){
+    runq_del(src, p);
+    if(sched_classes[p->sclass]->detach)
+      sched_classes[p->sclass]->detach(src, p);
+    moved[n++] = p;
+    gap -= 2 * p->weight;
+  }
+  release(&src->lock);
+  if(n == 0)
+    return;
+
+  acquire(&rq->lock);
+  cpus[rq - runqs].nlock++;
+  for(i = 0; i < n; i++){
+    runq_move(rq, moved[i]);
+    runq_add(rq, moved[i]);
+  }
+  release(&rq->lock);
+}
+
+// Halt this CPU until an interrupt arrives. rq->idle asks runq_kick()
+// for a reschedule IPI; it is set before the last look at the queue, and
+// "sti; hlt" cannot be split by an interrupt, so work queued after the
+// look still ends the halt.
+static void
+runq_idle(struct cpu *c, struct runq *rq)
+{
+  cli();
+  rq->idle = 1;
+  __sync_synchronize();
+  if(rq->n == 0){
+    c->nhalt++;
+    sched_timer(1);
+    asm volatile("sti; hlt");
+    tickupdate();     // the clock may have stopped with this timer
+  }
+  rq->idle = 0;
+}
+
+// Pass of p relative to its group's base on its CPU, as shown in the logs.
+uint
+sched_pass(struct proc *p)
+{
+  return p->pass - runqs[p->cpu].gq[p->group].base;
+}
+
+// cycles of the time stamp counter in 1/1024 ticks
+static uint
+sched_frac(uint cycles)
+{
+  return cycles / (tscpertick >> 10);
+}
+
+// Charge p f 1/1024 ticks through its class, at most four ticks at a
+// time so that stride * f cannot overflow: a process that ran many
+// ticks with its timer stopped pays for all of them. Returns whether
+// the class wants p to give up the CPU.
+static int
+sched_tick(struct runq *rq, struct proc *p, uint f)
+{
+  int preempt = 0;
+  uint g;
+
+  do {
+    g = f < 4096 ? f : 4096;
+    preempt |= sched_classes[p->sclass]->tick(rq, p, g);
+    f -= g;
+  } while(f > 0);
+  return preempt;
+}
+
+// p has just switched out on rq, whose lock is held: charge the rest
+// of its run. Under CHARGE_COMP, a process that blocked having used
+// only f of a tick gets compensation tickets making its tickets t/f
+// until it next switches out, as in lottery scheduling.
+static void
+runq_switchout(struct runq *rq, struct proc *p)
+{
+  uint now = rdtsc_lo(), f;
+
+  // Under CHARGE_TICK the class still sees the switch, for nothing.
+  f = chargemode == CHARGE_TICK ? 0 : sched_frac(now - p->tscin);
+  sched_tick(rq, p, f);
+  if(chargemode != CHARGE_COMP || p->stride == 0)
+    return;
+  f = sched_frac(now - p->tscrun);
+  p->comp = 0;
+  if(p->state == SLEEPING && f < 1024)
+    p->comp = p->tickets * (1024 - f) / (f ? f : 1);
+  restride(p);
+}
+
+// Charge the running process p at a timer tick, n ticks since it was
+// last charged (more than one if its timer was stopped): n whole ticks
+// under CHARGE_TICK, else the cycles since then. Logs the tick for
+// schedlog. Returns whether p's class wants it to give up the CPU.
+int
+sched_charge(struct proc *p, uint n)
+{
+  struct runq *rq = lockrq();
+  uint now = rdtsc_lo();
+  uint frac = chargemode == CHARGE_TICK ? n << 10 : sched_frac(now - p->tscin);
+  int preempt;
+
+  p->tscin = now;
+  preempt = sched_tick(rq, p, frac);
+  schedtr_record(SCHEDEV_TICK, p, sched_pass(p));
+  unlockrq();
+  return preempt;
+}
+
+// Arm this CPU's timer for the next tick it is wanted: the next one, or
+// with the timer stopped, the running process's end_ticks expiry or, on
+// CPU 0, the first tick a process sleeps until (see tickwait), within
+// TICKLESSMAX. With sooner set, only if the timer would go off later.
+// timerat is set before the last look at the queue and at tickswake, as
+// runq_kick() and tickwait() look at it after queueing work or a
+// sleeper. Interrupts must be off.
+void
+sched_timer(int sooner)
+{
+  struct cpu *c = mycpu();
+  struct runq *rq = &runqs[c - cpus];
+  struct proc *p = c->proc;
+  uint old = c->timerat, cnt;
+  int n = 1, left;
+
+  if(tickless && (p ? p->sclass != SCHED_DEADLINE : runq_busiest(rq) == 0)){
+    n = TICKLESSMAX;
+    if(p && p->end_ticks > 0 && (left = p->end_ticks - p->ticks) < n)
+      n = left > 0 ? left : 1;
+    // other CPUs have work queued: switch out for the next balance
+    if(p && runq_busiest(rq) != 0 &&
+       (left = rq->balanced + BALANCE_TICKS - ticks) < n)
+      n = left > 0 ? left : 1;
+    c->timerat = ticks + n;
+    __sync_synchronize();
+    if(rq->n > 0)
+      n = 1;
+    else if(c == cpus && (left = tickswake - ticks) < n)
+      n = left > 0 ? left : 1;
+  }
+  if(sooner && (cnt = lapictimerleft()) != 0 && (cnt - 1) / lapicpertick < n){
+    c->timerat = old;
+    return;
+  }
+  c->timerat = ticks + n;
+  lapictimer(n);
+}
+
+// Bucket of a wait of w 1/1024 ticks in the wait-time histograms.
+static int
+waitbucket(uint w)
+{
+  int b = 0;
+
+  while(w != 0 && b < NWAITHIST - 1){
+    w >>= 1;
+    b++;
+  }
+  return b;
+}
+
+// Count the wait of p, switched in at time stamp now on CPU c, since it
+// was queued, in p's and c's histograms. The wait is in 1/1024 ticks by
+// the counter, but in whole ticks once it is long enough that the low
+// half of the counter may have wrapped.
+static void
+sched_waited(struct cpu *c, struct proc *p, uint now)
+{
+  uint t = ticks - p->qtick, w;
+  int b;
+
+  w = t >= 16 ? t << 10 : (now - p->tscq) / (tscpertick >> 10);
+  b = waitbucket(w);
+  p->stat.nwait++;
+  p->stat.waitsum += w;
+  if(w > p->stat.waitmax)
+    p->stat.waitmax = w;
+  p->stat.waithist[b]++;
+  c->stat.nwait++;
+  c->stat.waitsum += w;
+  if(w > c->stat.waitmax)
+    c->stat.waitmax = w;
+  c->stat.waithist[b]++;
+}
+
+// Count p's switch out of CPU c: voluntary if it blocked or called
+// yield() itself, involuntary if it was preempted.
+static void
+sched_switched(struct cpu *c, struct proc *p)
+{
+  if(p->state == RUNNABLE && !p->yielded){
+    p->stat.nivcsw++;
+    c->stat.nivcsw++;
+  } else if(p->state == RUNNABLE || p->state == SLEEPING){
+    p->stat.nvcsw++;
+    c->stat.nvcsw++;
+  }
+  p->yielded = 0;
 }
 
 //PAGEBREAK: 42
@@ -370,54 +937,79 @@ rebase_pass(void){
 void
 scheduler(void)
 {
-  struct proc *p, *temp;
+  struct proc *p;
   struct cpu *c = mycpu();
+  struct runq *rq = &runqs[c - cpus];
   c->proc = 0;
-  
+
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
+    // Even out ticket load with the other CPUs now and then
+    if(ticks - rq->balanced >= BALANCE_TICKS){
+      rq->balanced = ticks;
+      runq_balance(rq);
+    }
 
-    // Rebase pass values if necessary
-    rebase_pass();   
+    acquire(&rq->lock);
+    c->nlock++;
 
-    // Find process with minimum pass value
-    temp = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      // Only consider RUNNABLE processes
-      if(p->state != RUNNABLE) continue;
+    // Take the next process by its class
+    p = runq_pop(rq);
 
-      // Select process with minimum pass value
-      if(temp == 0 || p->pass < temp->pass || (p->pass == temp->pass && p->pid < temp->pid))
-        temp = p;
-    }
-
-    // No RUNNABLE process
-    if(temp == 0){
-      release(&ptable.lock);
-      continue;
+    // Nothing queued here: steal from the busiest CPU, or halt
+    if(p == 0){
+      release(&rq->lock);
+      if((p = runq_steal(rq)) == 0){
+        runq_idle(c, rq);
+        continue;
+      }
+      acquire(&rq->lock);
+      c->nlock++;
+      runq_move(rq, p);
     }
 
     // Switch to chosen process.
-    c->proc = temp;
-    switchuvm(temp);
-    temp->state = RUNNING;
-    swtch(&c->scheduler, temp->context);
+    c->proc = p;
+    p->oncpu = 1;
+    p->lastcpu = c - cpus;
+    p->tickin = ticks;
+    sched_timer(1);
+    rq->running = p->weight;
+    switchuvm(p);
+    p->state = RUNNING;
+    schedtr_record(SCHEDEV_IN, p, 0);
+    p->tscin = p->tscrun = rdtsc_lo();
+    sched_waited(c, p, p->tscin);
+    swtch(&c->scheduler, p->context);
     switchkvm();
+    runq_switchout(rq, p);
+    sched_switched(c, p);
+    schedtr_record(SCHEDEV_OUT, p, p->state);
 
     // Process is done running
+    rq->running = 0;
+    p->oncpu = 0;
     c->proc = 0;
 
-    // drop ptable.lock before next round
-    release(&ptable.lock);
+    // It yielded on a CPU its affinity no longer allows: move it
+    if(p->state == RUNNABLE && !runq_allowed(rq, p)){
+      runq_del(rq, p);
+      if(sched_classes[p->sclass]->detach)
+        sched_classes[p->sclass]->detach(rq, p);
+      release(&rq->lock);
+      runq_push(p);
+      continue;
+    }
+
+    // drop the queue lock before next round
+    release(&rq->lock);
   }
 }
 
-// Enter scheduler.  Must hold only ptable.lock
-// and have changed proc->state. Saves and restores
+// Enter scheduler.  Must hold only this CPU's run queue
+// lock and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
 // be proc->intena and proc->ncli, but that would
@@ -429,8 +1021,8 @@ sched(void)
   int intena;
   struct proc *p = myproc();
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
+  if(!holding(&runqs[cpuid()].lock))
+    panic("sched runq lock");
   if(mycpu()->ncli != 1)
     panic("sched locks");
   if(p->state == RUNNING)
@@ -442,14 +1034,40 @@ sched(void)
   mycpu()->intena = intena;
 }
 
-// Give up the CPU for one scheduling round.
+// If deadline process p has spent its budget ahead of time, sleep until
+// its postponed reservation is due, a period before its deadline, and
+// return 1; otherwise return 0.
+static int
+dl_throttle(struct proc *p)
+{
+  uint due = p->dldeadline - p->dlperiod;
+
+  if(p->sclass != SCHED_DEADLINE || (int)(due - ticks) <= 0)
+    return 0;
+  acquire(&tickslock);
+  while((int)(due - ticks) > 0 && !p->killed){
+    tickwait(due);
+    sleep(&ticks, &tickslock);
+  }
+  release(&tickslock);
+  return 1;
+}
+
+// Give up the CPU for one scheduling round, or until its reservation
+// is due for a deadline process that has spent its budget.
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
+  struct runq *rq;
+  struct proc *p = myproc();
+
+  if(dl_throttle(p))
+    return;
+  rq = lockrq();  //DOC: yieldlock
+  runq_count(rq, p);
+  sched_classes[p->sclass]->yield(rq, p);
   sched();
-  release(&ptable.lock);
+  unlockrq();
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -458,8 +1076,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding the run queue lock from scheduler.
+  unlockrq();
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -473,10 +1091,94 @@ forkret(void)
   // Return to "caller", actually trapret (see allocproc).
 }
 
+// Link p into the sleep queue bucket of p->chan.
+// The ptable lock must be held.
+static void
+sleepq_add(struct proc *p)
+{
+  struct proc **head = &ptable.sleepq[SLEEPQ(p->chan)];
+
+  p->sqnext = *head;
+  p->sqprev = head;
+  if(*head)
+    (*head)->sqprev = &p->sqnext;
+  *head = p;
+}
+
+// Unlink p from its sleep queue bucket. The ptable lock must be held.
+static void
+sleepq_del(struct proc *p)
+{
+  *p->sqprev = p->sqnext;
+  if(p->sqnext)
+    p->sqnext->sqprev = p->sqprev;
+  p->sqnext = 0;
+  p->sqprev = 0;
+}
+
+// Tickets p schedules with: its own, those lent to it and compensation
+// tickets, within the range settickets() allows.
+int
+sched_tickets(struct proc *p)
+{
+  int t = p->tickets + p->lent + p->comp;
+
+  return t < STRIDE_MAX - 1 ? t : STRIDE_MAX - 1;
+}
+
+// Recompute p's stride from sched_tickets(), unless p never set tickets.
+static void
+restride(struct proc *p)
+{
+  if(p->stride)
+    p->stride = STRIDE_MAX / sched_tickets(p);
+}
+
+// Lend the tickets of p, about to sleep, to the process to, whose pid
+// must still be pid, until p is woken. Processes that never set tickets
+// (stride 0) neither lend nor change stride on borrowing. Only p's own
+// tickets are lent, so loans do not chain. The ptable lock must be held.
+static void
+lend(struct proc *p, struct proc *to, int pid)
+{
+  if(to == 0 || to == p || to->pid != pid || p->stride == 0)
+    return;
+  if(to->state < SLEEPING || to->state > RUNNING)
+    return;
+  p->lendto = to;
+  p->lendpid = pid;
+  to->lent += p->tickets;
+  restride(to);
+}
+
+// Take back what p lent, unless the borrower has exited since.
+// The ptable lock must be held.
+static void
+unlend(struct proc *p)
+{
+  struct proc *to = p->lendto;
+
+  if(to == 0)
+    return;
+  p->lendto = 0;
+  if(to->pid != p->lendpid)
+    return;
+  to->lent -= p->tickets;
+  restride(to);
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
 sleep(void *chan, struct spinlock *lk)
+{
+  sleepfor(chan, lk, 0, 0);
+}
+
+// sleep(), lending the caller's tickets to the process it is waiting
+// on, to (with pid pid), until it is woken. to may be 0.
+void
+sleepfor(void *chan, struct spinlock *lk, struct proc *to, int pid)
 {
   struct proc *p = myproc();
   
@@ -496,20 +1198,24 @@ sleep(void *chan, struct spinlock *lk)
     acquire(&ptable.lock);  //DOC: sleeplock1
     release(lk);
   }
-  // Go to sleep.
+  // Go to sleep. A wakeup queues p on this CPU, which it cannot
+  // lock until p has switched out.
   p->chan = chan;
   p->state = SLEEPING;
+  ptable.group[p->group].load -= p->tickets;
+  lend(p, to, pid);
+  sleepq_add(p);
+  lockrq();
+  release(&ptable.lock);
 
   sched();
+  unlockrq();
 
   // Tidy up.
   p->chan = 0;
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  acquire(lk);  //DOC: sleeplock2
 }
 
 //PAGEBREAK!
@@ -518,11 +1224,15 @@ sleep(void *chan, struct spinlock *lk)
 static void
 wakeup1(void *chan)
 {
-  struct proc *p;
+  struct proc *p, *next;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  for(p = ptable.sleepq[SLEEPQ(chan)]; p; p = next){
+    next = p->sqnext;
+    if(p->state == SLEEPING && p->chan == chan){
+      sleepq_del(p);
+      runq_wake(p);
+    }
+  }
 }
 
 // Wake up all processes sleeping on chan.
@@ -547,8 +1257,14 @@ kill(int pid)
     if(p->pid == pid){
       p->killed = 1;
       // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
+      if(p->state == SLEEPING){
+        sleepq_del(p);
+        runq_wake(p);
+      }
+      // Interrupt it if it is running elsewhere, maybe with the timer
+      // stopped, so that it exits now.
+      else if(p->state == RUNNING && p->cpu != cpuid())
+        lapicipi(cpus[p->cpu].apicid, T_RESCHED);
       release(&ptable.lock);
       return 0;
     }
@@ -557,6 +1273,427 @@ kill(int pid)
   return -1;
 }
 
+// Lock and return the run queue of the CPU p belongs to. p->cpu only
+// changes under the queue lock of its new CPU.
+static struct runq*
+lockrq_of(struct proc *p)
+{
+  struct runq *rq;
+
+  for(;;){
+    rq = &runqs[p->cpu];
+    acquire(&rq->lock);
+    if(rq == &runqs[p->cpu])
+      return rq;
+    release(&rq->lock);
+  }
+}
+
+// Stride of group gid.
+uint
+group_stride(int gid)
+{
+  return ptable.group[gid].stride;
+}
+
+// Drop a member from group gid, freeing the group with its last member.
+// Group 0 is never freed. The ptable lock must be held.
+static void
+group_put(int gid)
+{
+  struct group *g = &ptable.group[gid];
+
+  if(--g->nproc == 0 && gid != 0){
+    g->tickets = 0;
+    g->stride = 0;
+  }
+}
+
+// Set the tickets of the current process, keeping its group's load.
+void
+settickets(int tickets)
+{
+  struct proc *p = myproc();
+
+  acquire(&ptable.lock);
+  ptable.group[p->group].load += tickets - p->tickets;
+  p->tickets = tickets;
+  p->stride = STRIDE_MAX / sched_tickets(p);
+  release(&ptable.lock);
+}
+
+// Set how running processes are charged and return the previous mode,
+// or -1 if mode is not a CHARGE_* mode. Compensation tickets are dropped
+// on leaving CHARGE_COMP.
+int
+schedcharge(int mode)
+{
+  struct proc *p;
+  int old;
+
+  if(mode < CHARGE_TICK || mode > CHARGE_COMP)
+    return -1;
+  acquire(&ptable.lock);
+  old = chargemode;
+  chargemode = mode;
+  if(mode != CHARGE_COMP){
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+      if(p->comp){
+        p->comp = 0;
+        restride(p);
+      }
+    }
+  }
+  release(&ptable.lock);
+  return old;
+}
+
+// Turn dynamic ticks on (1) or off (0), or leave them (-1), and return
+// the previous setting, or -1 if on is none of these. CPUs with their
+// timer stopped pick up the change at their next interrupt.
+int
+settickless(int on)
+{
+  int old;
+
+  if(on < -1 || on > 1)
+    return -1;
+  acquire(&ptable.lock);
+  old = tickless;
+  if(on >= 0)
+    tickless = on;
+  release(&ptable.lock);
+  return old;
+}
+
+// Utilization of a reservation of runtime ticks every period ticks,
+// in 1/1024ths of a CPU.
+static int
+dl_util(int runtime, int period)
+{
+  return (runtime << 10) / period;
+}
+
+// Move p to scheduler class cls, requeueing it if it is queued and
+// giving back its reservation if it leaves the deadline class.
+// The ptable lock must be held.
+static void
+sched_move(struct proc *p, int cls)
+{
+  struct runq *rq = lockrq_of(p);
+
+  if(p->sclass != cls){
+    int queued = p->state == RUNNABLE && p->rqidx >= 0;
+    if(queued)
+      runq_del(rq, p);
+    if(p->sclass == SCHED_DEADLINE)
+      rq->dlutil -= dl_util(p->dlruntime, p->dlperiod);
+    p->sclass = cls;
+    if(queued)
+      runq_add(rq, p);
+  }
+  release(&rq->lock);
+}
+
+// Put the process with the given pid, or with pid 0 every process
+// outside the deadline class, in scheduler class cls (SCHED_*), which
+// cannot be the deadline class: that takes setdeadline(). Children
+// inherit their parent's class. Returns the process's previous class
+// (0 for pid 0), or -1.
+int
+setsched(int pid, int cls)
+{
+  struct proc *p;
+  int old = -1;
+
+  if(cls < 0 || cls >= NSCHED || cls == SCHED_DEADLINE)
+    return -1;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state < SLEEPING || p->state > RUNNING)
+      continue;
+    if(pid == 0 && p->sclass == SCHED_DEADLINE)
+      continue;
+    if(pid == 0 || p->pid == pid){
+      old = pid == 0 ? 0 : p->sclass;
+      sched_move(p, cls);
+      if(pid != 0)
+        break;
+    }
+  }
+  release(&ptable.lock);
+  return old;
+}
+
+// Let the process with the given pid run only on the CPUs in mask, one
+// bit each, and return its previous mask, or -1 if there is no such
+// process or mask names no CPU, or leaves out the CPU that admitted a
+// deadline class process. A queued process moves at once, a running one
+// at its next yield (one on another CPU is told to yield now), and a
+// sleeping one when it wakes. Children inherit their parent's mask.
+int
+setaffinity(int pid, uint mask)
+{
+  struct proc *p;
+  struct runq *rq;
+  int old;
+
+  mask &= (1 << ncpu) - 1;
+  if(mask == 0)
+    return -1;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid && p->state >= SLEEPING && p->state <= RUNNING)
+      break;
+  if(p == &ptable.proc[NPROC] ||
+     (p->sclass == SCHED_DEADLINE && !((mask >> p->cpu) & 1))){
+    release(&ptable.lock);
+    return -1;
+  }
+
+  rq = lockrq_of(p);
+  old = p->affinity & ((1 << ncpu) - 1);
+  p->affinity = mask;
+  if(!runq_allowed(rq, p)){
+    if(p->state == RUNNABLE && p->rqidx >= 0){
+      runq_del(rq, p);
+      if(sched_classes[p->sclass]->detach)
+        sched_classes[p->sclass]->detach(rq, p);
+      release(&rq->lock);
+      runq_push(p);
+      release(&ptable.lock);
+      return old;
+    }
+    if(p->state == RUNNING && p != myproc())
+      lapicipi(cpus[p->cpu].apicid, T_RESCHED);
+  }
+  release(&rq->lock);
+  release(&ptable.lock);
+
+  // Move off this CPU now if the caller just left it.
+  if(p == myproc() && !runq_allowed(rq, p))
+    yield();
+  return old;
+}
+
+// Copy the process with the given pid, or with pid <= 0 the current
+// one, to pi. Returns 0, or -1 if there is no such process.
+int
+getprocinfo(int pid, struct procinfo *pi)
+{
+  struct proc *p, *t = 0;
+
+  acquire(&ptable.lock);
+  if(pid <= 0)
+    t = myproc();
+  else {
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+      if(p->pid == pid && p->state != UNUSED){
+        t = p;
+        break;
+      }
+  }
+  if(t == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  pi->pid = t->pid;
+  pi->ppid = t->parent ? t->parent->pid : 0;
+  pi->state = t->state;
+  pi->sz = t->sz;
+  safestrcpy(pi->name, t->name, sizeof(pi->name));
+  pi->sclass = t->sclass;
+  pi->tickets = t->tickets;
+  pi->cpu = t->lastcpu;
+  pi->stat = t->stat;
+  release(&ptable.lock);
+  return 0;
+}
+
+// Sum the switch counts and wait times of every CPU into st and return
+// the number of CPUs. The counters are read without locks.
+int
+schedstat(struct schedstat *st)
+{
+  struct schedstat *c;
+
+  memset(st, 0, sizeof(*st));
+  for(int i = 0; i < ncpu; i++){
+    c = &cpus[i].stat;
+    st->nvcsw += c->nvcsw;
+    st->nivcsw += c->nivcsw;
+    st->nwait += c->nwait;
+    st->waitsum += c->waitsum;
+    if(c->waitmax > st->waitmax)
+      st->waitmax = c->waitmax;
+    for(int b = 0; b < NWAITHIST; b++)
+      st->waithist[b] += c->waithist[b];
+  }
+  return ncpu;
+}
+
+// Copy the CPU placement of the process with the given pid to a.
+// Returns 0, or -1 if there is no such process.
+int
+getaffinity(int pid, struct affinity *a)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED){
+      a->mask = p->affinity & ((1 << ncpu) - 1);
+      a->cpu = p->lastcpu;
+      a->migrations = p->nmigrate;
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Put the current process in the deadline class with a reservation of
+// runtime ticks every period ticks, or with runtime 0 take it back to
+// the stride class. A reservation is admitted only if those of the
+// process's CPU still fit in it; processes never leave the CPU that
+// admitted them. Returns 0, or -1 if not admitted.
+int
+setdeadline(int runtime, int period)
+{
+  struct proc *p = myproc();
+  struct runq *rq;
+  int u = runtime > 0 ? dl_util(runtime, period) : 0;
+  int old = 0;
+
+  acquire(&ptable.lock);
+  rq = &runqs[p->cpu];
+  if(p->sclass == SCHED_DEADLINE)
+    old = dl_util(p->dlruntime, p->dlperiod);
+  if(rq->dlutil - old + u > 1024){
+    release(&ptable.lock);
+    return -1;
+  }
+  if(runtime == 0){
+    if(p->sclass == SCHED_DEADLINE)
+      sched_move(p, SCHED_STRIDE);
+    release(&ptable.lock);
+    return 0;
+  }
+  rq->dlutil += u - old;
+  p->dlruntime = runtime;
+  p->dlperiod = period;
+  p->dldeadline = p->dljob = ticks + period;
+  p->dlleft = runtime << 10;
+  p->dlmissed = 0;
+  p->sclass = SCHED_DEADLINE;   // p is running, not queued
+  release(&ptable.lock);
+  return 0;
+}
+
+// Copy the deadline class state of the process with the given pid to
+// st. Returns 0, or -1 if there is no such process.
+int
+dlstat(int pid, struct dlstat *st)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED){
+      st->runtime = p->sclass == SCHED_DEADLINE ? p->dlruntime : 0;
+      st->period = p->sclass == SCHED_DEADLINE ? p->dlperiod : 0;
+      st->misses = p->dlmisses;
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Create a scheduling group with the given tickets and return its id,
+// or -1 if all NGROUP groups are in use. The group is freed when its
+// last member exits or leaves it.
+int
+grpcreate(int tickets)
+{
+  int gid;
+
+  acquire(&ptable.lock);
+  for(gid = 1; gid < NGROUP; gid++){
+    if(ptable.group[gid].tickets == 0){
+      ptable.group[gid].tickets = tickets;
+      ptable.group[gid].stride = STRIDE_MAX / tickets;
+      ptable.group[gid].nproc = 0;
+      ptable.group[gid].load = 0;
+      release(&ptable.lock);
+      return gid;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Set the tickets of group gid.
+int
+grptickets(int gid, int tickets)
+{
+  acquire(&ptable.lock);
+  if(gid < 0 || gid >= NGROUP || ptable.group[gid].tickets == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  ptable.group[gid].tickets = tickets;
+  ptable.group[gid].stride = STRIDE_MAX / tickets;
+  release(&ptable.lock);
+  return 0;
+}
+
+// Move the process with the given pid to group gid. A queued process is
+// requeued under its new group; the queue lock of its CPU keeps it from
+// being queued or picked meanwhile.
+int
+setgroup(int pid, int gid)
+{
+  struct proc *p;
+  struct runq *rq;
+  int old;
+
+  acquire(&ptable.lock);
+  if(gid < 0 || gid >= NGROUP || ptable.group[gid].tickets == 0)
+    goto bad;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid && p->state >= SLEEPING && p->state <= RUNNING)
+      break;
+  if(p == &ptable.proc[NPROC])
+    goto bad;
+
+  rq = lockrq_of(p);
+  old = p->group;
+  if(old != gid){
+    int queued = p->state == RUNNABLE && p->rqidx >= 0;
+    if(queued)
+      runq_del(rq, p);
+    if(p->state == RUNNABLE || p->state == RUNNING){
+      ptable.group[old].load -= p->tickets;
+      ptable.group[gid].load += p->tickets;
+    }
+    p->group = gid;
+    ptable.group[gid].nproc++;
+    group_put(old);
+    if(queued)
+      runq_add(rq, p);
+  }
+  release(&rq->lock);
+  release(&ptable.lock);
+  return 0;
+
+bad:
+  release(&ptable.lock);
+  return -1;
+}
+
 //PAGEBREAK: 36
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
@@ -1,3 +1,18 @@
+// Buckets of the wait-time histograms: under 1/1024 tick, then one per
+// power of two of 1/1024 ticks, the last open-ended
+#define NWAITHIST 16
+
+// Switch counts and RUNNABLE wait times, of a process or a CPU, as
+// returned by get_procinfo() and schedstat(). Waits are in 1/1024 ticks.
+struct schedstat {
+  uint nvcsw;                  // Switches out by blocking or yield()
+  uint nivcsw;                 // ... by preemption
+  uint nwait;                  // Waits from being queued to running
+  uint waitsum;                // ... their total
+  uint waitmax;                // ... the longest
+  uint waithist[NWAITHIST];    // ... by length
+};
+
 // Per-CPU state
 struct cpu {
   uchar apicid;                // Local APIC ID
@@ -8,11 +23,63 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  uint nticks;                 // Timer ticks taken
+  uint nidle;                  // ... of which found no process running
+  uint nlock;                  // Run queue lock acquisitions by the scheduler
+  uint nhalt;                  // Times the scheduler halted for want of work
+  uint nipi;                   // Reschedule IPIs received
+  uint timerat;                // ticks when its timer is armed to go off
+  struct schedstat stat;       // Switches and waits of processes run here
 };
 
 extern struct cpu cpus[NCPU];
 extern int ncpu;
 
+// Per-CPU scheduler counters, as returned by cpustat()
+struct cpustat {
+  uint ticks;                  // Timer ticks taken
+  uint idle;                   // ... with no process running
+  uint locks;                  // Run queue lock acquisitions by the scheduler
+  uint halts;                  // Idle halts
+  uint ipis;                   // Reschedule IPIs received
+};
+
+// The timer, as returned by timerinfo()
+struct timerinfo {
+  int hz;                      // Ticks a second
+  uint uspertick;              // Microseconds per tick
+  uint lapicpertick;           // LAPIC timer counts per tick
+  uint tscpertick;             // Time stamp counter cycles per tick
+  int tickless;                // Dynamic ticks on (see settickless)
+};
+
+// Deadline class state of a process, as returned by dlstat()
+struct dlstat {
+  int runtime;                 // Budget per period in ticks, 0 if not in the class
+  int period;                  // Period and relative deadline in ticks
+  uint misses;                 // Deadlines passed with the process still runnable
+};
+
+// A process as returned by get_procinfo()
+struct procinfo {
+  int pid;                     // Process ID
+  int ppid;                    // Parent process ID
+  int state;                   // procstate value
+  uint sz;                     // Address-space size
+  char name[16];               // Process name
+  int sclass;                  // Scheduler class
+  int tickets;                 // Tickets
+  int cpu;                     // CPU it last ran on, -1 if it has not run
+  struct schedstat stat;       // Its switches and waits
+};
+
+// CPU placement of a process, as returned by getaffinity()
+struct affinity {
+  uint mask;                   // CPUs it may run on, one bit each
+  int cpu;                     // CPU it last ran on, -1 if it has not run
+  uint migrations;             // Moves to another CPU's run queue
+};
+
 //PAGEBREAK: 17
 // Saved registers for kernel context switches.
 // Don't need to save all the segment registers (%cs, etc),
@@ -54,6 +121,48 @@ struct proc {
   uint pass;                   // Pass value for stride scheduling
   int ticks;                   // Number of ticks the process has run
   int end_ticks;               // Number of ticks the process has run in the end
+  uint tickin;                 // ticks when it was last counted in ticks
+  int rqidx;                   // Index in the run queue heap, -1 if not queued
+  int cpu;                     // CPU whose run queue p belongs to
+  volatile int oncpu;          // Set while p's context is live on a CPU
+  struct proc *sqnext;         // Next process in the same sleep queue bucket
+  struct proc **sqprev;        // Link pointing at this process in its bucket
+  int group;                   // Scheduling group
+  int weight;                  // Share of its group's tickets while queued
+  int lent;                    // Tickets lent to it by processes waiting on it
+  struct proc *lendto;         // Process holding its tickets while it sleeps
+  int lendpid;                 // ... and that process's pid
+  int comp;                    // Compensation tickets for a short last run
+  uint tscin;                  // Time stamp counter when last charged
+  uint tscrun;                 // ... and when it was last switched in
+  int sclass;                  // Scheduler class (SCHED_*)
+  struct proc *rqnext;         // Next in the round-robin queue
+  struct proc *rqprev;         // Previous in the round-robin queue
+  int dlruntime;               // Deadline class: budget per period, in ticks
+  int dlperiod;                // ... period and relative deadline, in ticks
+  uint dldeadline;             // ... deadline of the current reservation
+  int dlleft;                  // ... budget left in it, in 1/1024 ticks
+  uint dljob;                  // ... deadline it was renewed with
+  int dlmissed;                // ... set once that deadline has been missed
+  uint dlmisses;               // ... deadlines missed
+  uint affinity;               // CPUs p may run on, one bit each
+  int lastcpu;                 // CPU p last ran on, -1 if it has not run
+  uint qtick;                  // ticks when last queued
+  uint nmigrate;               // Moves to another CPU's run queue
+  uint tscq;                   // Time stamp counter when last queued
+  int yielded;                 // Set while giving up the CPU by sys_yield
+  struct schedstat stat;       // Switches and waits
+};
+
+// Scheduling group. Each CPU divides its time among the groups with
+// members queued on it by group stride, then within a group among the
+// members by their own strides, so a group's share does not grow with
+// the number of processes in it.
+struct group {
+  int tickets;                 // Group tickets, 0 if the slot is free
+  uint stride;                 // Stride value for the group
+  int nproc;                   // Members that have not exited
+  int load;                    // Tickets of the RUNNABLE and RUNNING members
 };
 
 // Stride scheduling constants which are fixed by spec
@@ -61,6 +170,24 @@ struct proc {
 #define PASS_MAX 15000
 #define DISTANCE_MAX 7500
 
+// Scheduler classes (see sclass.h), in the order they are picked from
+#define SCHED_DEADLINE 0
+#define SCHED_STRIDE   1
+#define SCHED_LOTTERY  2
+#define SCHED_RR       3
+#define NSCHED         4
+
+// Longest deadline class period, in ticks
+#define DL_PERIOD_MAX 1000
+
+// How running processes are charged (see schedcharge)
+#define CHARGE_TICK  0         // a whole stride per timer tick
+#define CHARGE_EXACT 1         // by time stamp counter cycles run
+#define CHARGE_COMP  2         // ... plus compensation tickets
+
+// Tickets of group 0, which holds every process not moved elsewhere
+#define GROUP_TICKETS 100
+
 // Process memory is laid out contiguously, low addresses first:
 //   text
 //   original data and bss
@@ -0,0 +1,104 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define NMAX 1000
+
+// time stamp counter in units of 1024 cycles
+static uint
+kcycles(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return (hi << 22) | (lo >> 10);
+}
+
+// kc kilocycles spread over n switches, in cycles per switch
+static uint
+per_switch(uint kc, uint n)
+{
+  uint q = kc / n, r = kc % n;
+
+  if(n < 1024*1024)
+    return q * 1024 + r * 1024 / n;
+  return q * 1024 + r / (n / 1024);
+}
+
+// child: wait for the stop tick, then yield until it passes and report
+// the number of yields
+static void
+child(int go, int done)
+{
+  int stop;
+  uint n = 0;
+
+  if(settickets(10, 0) < 0) fail("settickets");
+  stop = benchstop(go);
+  while(uptime() < stop){
+    for(int i = 0; i < 64; i++)
+      yield();
+    n += 64;
+  }
+  write(done, &n, sizeof(n));
+  exit();
+}
+
+// n runnable processes yield for ticks ticks; print the switch rate
+static void
+run(int n, int ticks)
+{
+  int go[2], done[2];
+  uint total = 0, c;
+
+  benchpipes(go, done);
+  for(int i = 0; i < n; i++)
+    if(benchfork(go, done) == 0)
+      child(go[0], done[1]);
+
+  // release everyone at once
+  uint t0 = kcycles();
+  benchgo(go, done, n, ticks);
+  for(int i = 0; i < n; i++){
+    benchread(done[0], &c, sizeof(c));
+    total += c;
+  }
+  uint kc = kcycles() - t0;
+  for(int i = 0; i < n; i++)
+    wait();
+  close(go[1]);
+  close(done[0]);
+
+  printf(1, "%d\t%d\t%d\t%d\n", n, total, total / ticks, total ? per_switch(kc, total) : 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ticks = 100;
+  int nlist[16], nn = 0;
+
+  benchinit("schedbench", "[-t ticks] [nproc ...]");
+  for(int i = 1; i < argc; i++){
+    if(argv[i][0] == '-'){
+      if(argv[i][1] != 't' || i + 1 >= argc) usage();
+      ticks = atoi(argv[++i]);
+    }else if(nn < 16){
+      nlist[nn++] = atoi(argv[i]);
+    }
+  }
+  if(nn == 0){
+    nlist[nn++] = 8;
+    nlist[nn++] = 64;
+    nlist[nn++] = 512;
+  }
+  if(ticks <= 0) usage();
+
+  printf(1, "[schedbench] %d ticks per run; cycles are wall-clock per switch\n", ticks);
+  printf(1, "[nproc]\t[switches]\t[per tick]\t[cycles]\n");
+  for(int i = 0; i < nn; i++){
+    if(nlist[i] <= 0 || nlist[i] > NMAX) usage();
+    run(nlist[i], ticks);
+  }
+  exit();
+}
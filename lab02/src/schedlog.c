@@ -0,0 +1,98 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NBUF 64
+
+static struct schedev buf[NBUF];
+static int all;       // -a: every process, not only scheduler test processes
+static int verbose;   // -v: switch-in/out events too
+
+static void
+usage(void)
+{
+  printf(1, "usage: schedlog [-a] [-v] [-e] [-f]\n");
+  exit();
+}
+
+// the old console log only covered processes whose parent was a test
+static int
+shown(struct schedev *e)
+{
+  return all || (e->pid > 2 && e->ppid > 2);
+}
+
+static char*
+statename(uint s)
+{
+  static char *names[] = { "unused", "embryo", "sleep", "runnable", "run", "zombie" };
+  return s < 6 ? names[s] : "???";
+}
+
+// print e the way the kernel used to print it
+static void
+decode(struct schedev *e)
+{
+  if(!shown(e))
+    return;
+  switch(e->type){
+  case SCHEDEV_FORK:
+    printf(1, "Process %d start\n", e->pid);
+    break;
+  case SCHEDEV_EXIT:
+    printf(1, "Process %d exit\n", e->pid);
+    break;
+  case SCHEDEV_TICK:
+    printf(1, "Process %d selected, stride : %d, ticket : %d, pass : %d -> %d  (%d/%d)\n",
+           e->pid, e->stride, e->tickets, e->pass, e->npass, e->ticks, e->end_ticks);
+    break;
+  case SCHEDEV_IN:
+    if(verbose)
+      printf(1, "[%d] cpu%d in  pid %d pass %d\n", e->tick, e->cpu, e->pid, e->pass);
+    break;
+  case SCHEDEV_OUT:
+    if(verbose)
+      printf(1, "[%d] cpu%d out pid %d pass %d -> %s\n", e->tick, e->cpu, e->pid, e->pass,
+             statename(e->npass));
+    break;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedtr_cursor cur;
+  int follow = 0, fromend = 0, n;
+
+  for(int i = 1; i < argc; i++){
+    if(argv[i][0] != '-') usage();
+    if(argv[i][1] == 'a') all = 1;
+    else if(argv[i][1] == 'v') verbose = 1;
+    else if(argv[i][1] == 'e') fromend = 1;
+    else if(argv[i][1] == 'f') follow = 1;
+    else usage();
+  }
+
+  memset(&cur, 0, sizeof(cur));
+  if(fromend && sched_trace_read(buf, 0, &cur) < 0){
+    printf(1, "schedlog: sched_trace_read failed\n");
+    exit();
+  }
+
+  for(;;){
+    uint lost = cur.lost;
+    while((n = sched_trace_read(buf, NBUF, &cur)) > 0)
+      for(int i = 0; i < n; i++)
+        decode(&buf[i]);
+    if(n < 0){
+      printf(1, "schedlog: sched_trace_read failed\n");
+      exit();
+    }
+    if(cur.lost != lost)
+      printf(1, "schedlog: %d events lost\n", cur.lost - lost);
+    if(!follow)
+      break;
+    sleep(1);
+  }
+  exit();
+}
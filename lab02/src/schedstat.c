@@ -0,0 +1,115 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+static int hist;      // -h: wait-time histograms too
+
+static void
+usage(void)
+{
+  printf(1, "usage: schedstat [-h] [pid...] | [-h] -c command [args...]\n");
+  exit();
+}
+
+// w 1/1024 ticks as ticks with three decimals
+static void
+printticks(uint w)
+{
+  uint m = w * 1000 / 1024;
+
+  printf(1, "%d.%d%d%d", m / 1000, m / 100 % 10, m / 10 % 10, m % 10);
+}
+
+static void
+show(char *who, struct schedstat *st)
+{
+  printf(1, "%s: %d voluntary, %d involuntary switches, %d waits, mean ",
+         who, st->nvcsw, st->nivcsw, st->nwait);
+  printticks(st->nwait ? st->waitsum / st->nwait : 0);
+  printf(1, " max ");
+  printticks(st->waitmax);
+  printf(1, " ticks\n");
+  if(!hist)
+    return;
+
+  uint most = 1;
+  for(int b = 0; b < NWAITHIST; b++)
+    if(st->waithist[b] > most)
+      most = st->waithist[b];
+  printf(1, "  [wait, 1/1024 ticks]\t[count]\n");
+  for(int b = 0; b < NWAITHIST; b++){
+    // bucket b holds waits of [2^(b-1), 2^b) 1/1024 ticks
+    if(b == NWAITHIST - 1)
+      printf(1, "  >= %d\t%d\t", 1 << (b - 1), st->waithist[b]);
+    else
+      printf(1, "  < %d\t%d\t", 1 << b, st->waithist[b]);
+    for(uint i = 0; i < st->waithist[b] * 40 / most; i++)
+      printf(1, "#");
+    printf(1, "\n");
+  }
+}
+
+// Run argv and show what the whole system did meanwhile.
+static void
+command(char **argv)
+{
+  struct schedstat a, b;
+  int pid;
+
+  if(schedstat(&a) < 0) usage();
+  if((pid = fork()) < 0){
+    printf(1, "schedstat: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[0], argv);
+    printf(1, "schedstat: exec %s failed\n", argv[0]);
+    exit();
+  }
+  wait();
+  schedstat(&b);
+
+  b.nvcsw -= a.nvcsw;
+  b.nivcsw -= a.nivcsw;
+  b.nwait -= a.nwait;
+  b.waitsum -= a.waitsum;
+  for(int i = 0; i < NWAITHIST; i++)
+    b.waithist[i] -= a.waithist[i];
+  show(argv[0], &b);    // max is since boot
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  struct procinfo info;
+  int i, n;
+
+  for(i = 1; i < argc && argv[i][0] == '-'; i++){
+    if(argv[i][1] == 'h') hist = 1;
+    else if(argv[i][1] == 'c' && i + 1 < argc){
+      command(argv + i + 1);
+      exit();
+    }
+    else usage();
+  }
+
+  if(i == argc){
+    if((n = schedstat(&st)) < 0){
+      printf(1, "schedstat: schedstat failed\n");
+      exit();
+    }
+    printf(1, "%d cpus\n", n);
+    show("all", &st);
+    exit();
+  }
+  for(; i < argc; i++){
+    if(get_procinfo(atoi(argv[i]), &info) < 0){
+      printf(1, "schedstat: no process %s\n", argv[i]);
+      continue;
+    }
+    printf(1, "%d ", info.pid);
+    show(info.name, &info.stat);
+  }
+  exit();
+}
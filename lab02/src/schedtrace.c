@@ -0,0 +1,131 @@
+// schedtrace.c — scheduler trace for schedlog and the scheduler tests
+//
+// Switch-ins and switch-outs, charged timer ticks, forks and exits each
+// leave a struct schedev with the process's tickets, stride and pass
+// around the event, where trap() used to cprintf a line per tick. The
+// events of a CPU go to that CPU's own ring from code that already runs
+// with interrupts off or under pushcli, so recording is a few stores and
+// the timer path never waits on the console lock. Old events are simply
+// overwritten; schedlog, reading through sched_trace_read(), is told how
+// many it missed.
+//
+// The reader is the one of lab03's pfevent.c: it merges the rings by a
+// global sequence number, and counts as lost whatever a CPU overwrote
+// before or during the copy, judging by its ring head afterwards.
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "defs.h"
+#include "schedtrace.h"
+
+struct schedtr_ring {
+  volatile uint head;             // Events ever written to this ring
+  struct schedev ev[SCHEDTR_RING];
+};
+
+static struct schedtr_ring schedtr_rings[NCPU];
+static volatile uint schedtr_seq;
+
+// Append an event about p to this CPU's ring.
+void
+schedtr_record(int type, struct proc *p, uint npass)
+{
+  pushcli();
+  int c = cpuid();
+  struct schedtr_ring *r = &schedtr_rings[c];
+  uint h = r->head;
+  struct schedev *e = &r->ev[h & (SCHEDTR_RING - 1)];
+
+  e->seq       = __sync_fetch_and_add(&schedtr_seq, 1);
+  e->tick      = ticks;
+  e->cpu       = c;
+  e->type      = type;
+  e->pid       = p->pid;
+  e->ppid      = p->parent ? p->parent->pid : 0;
+  e->tickets   = p->tickets;
+  e->stride    = p->stride;
+  e->pass      = sched_pass(p);
+  e->npass     = npass;
+  e->ticks     = p->ticks;
+  e->end_ticks = p->end_ticks;
+
+  // publish the record before moving the head
+  __sync_synchronize();
+  r->head = h + 1;
+  popcli();
+}
+
+// Move cur past everything logged so far.
+void
+schedtr_seek_end(struct schedtr_cursor *cur)
+{
+  for(int c = 0; c < ncpu; c++)
+    cur->pos[c] = schedtr_rings[c].head;
+}
+
+// Copy up to max scheduling events after cur into out in the order they
+// happened across CPUs, and advance cur. Events a CPU overwrote first
+// count in cur->lost. *consumed is the number of ring slots cur moved
+// past; returns the number of events in out.
+int
+schedtr_read(struct schedev *out, int max, struct schedtr_cursor *cur, int *consumed)
+{
+  uint head[NCPU], start[NCPU], skip[NCPU];
+  uchar src[32];    // ring each out[] record came from
+  int n = 0, k = 0, c;
+
+  if(max > NELEM(src)) max = NELEM(src);
+  *consumed = 0;
+
+  // skip what has already been overwritten
+  for(c = 0; c < ncpu; c++){
+    head[c] = schedtr_rings[c].head;
+    if(head[c] - cur->pos[c] > SCHEDTR_RING){
+      cur->lost += head[c] - cur->pos[c] - SCHEDTR_RING;
+      cur->pos[c] = head[c] - SCHEDTR_RING;
+    }
+    start[c] = cur->pos[c];
+  }
+  __sync_synchronize();
+
+  // merge the rings by sequence number
+  while(n < max){
+    int best = -1;
+    uint bseq = 0;
+    for(c = 0; c < ncpu; c++){
+      if(cur->pos[c] == head[c]) continue;
+      uint s = schedtr_rings[c].ev[cur->pos[c] & (SCHEDTR_RING - 1)].seq;
+      if(best < 0 || (int)(s - bseq) < 0){
+        best = c;
+        bseq = s;
+      }
+    }
+    if(best < 0) break;
+    out[n] = schedtr_rings[best].ev[cur->pos[best] & (SCHEDTR_RING - 1)];
+    src[n] = best;
+    cur->pos[best]++;
+    n++;
+  }
+  *consumed = n;
+  __sync_synchronize();
+
+  // drop records the writers may have overwritten during the copy,
+  // counting the slot of one still being written (head not yet bumped)
+  for(c = 0; c < ncpu; c++){
+    uint h2 = schedtr_rings[c].head;
+    skip[c] = 0;
+    if(h2 + 1 - start[c] > SCHEDTR_RING)
+      skip[c] = h2 + 1 - start[c] - SCHEDTR_RING;
+  }
+  for(int i = 0; i < n; i++){
+    if(skip[src[i]] > 0){
+      skip[src[i]]--;
+      cur->lost++;
+      continue;
+    }
+    out[k++] = out[i];
+  }
+  return k;
+}
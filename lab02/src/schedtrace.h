@@ -0,0 +1,43 @@
+// Scheduler trace (per-CPU rings of binary scheduling events)
+#ifndef SCHEDTRACE_H
+#define SCHEDTRACE_H
+
+#include "types.h"
+#include "param.h"
+
+#define SCHEDTR_RING 1024  // events per CPU ring (power of two)
+
+// Event types
+#define SCHEDEV_IN   1     // switched in by the scheduler
+#define SCHEDEV_OUT  2     // switched back out; npass holds the new state
+#define SCHEDEV_TICK 3     // timer tick charged: pass -> npass
+#define SCHEDEV_FORK 4     // created by fork()
+#define SCHEDEV_EXIT 5     // exit()
+
+// Scheduler event record
+struct schedev {
+  uint seq;       // Global sequence number (orders events across CPUs)
+  uint tick;      // Tick of the event
+  ushort cpu;     // CPU that logged it
+  ushort type;    // SCHEDEV_*
+  int pid;        // Process
+  int ppid;       // Its parent (0 if none)
+  int tickets;    // Tickets at the event
+  uint stride;    // Stride at the event
+  uint pass;      // Pass relative to the queue base
+  uint npass;     // TICK: pass after the charge; OUT: procstate after
+  int ticks;      // Ticks run so far
+  int end_ticks;  // Tick budget (-1 if none)
+};
+
+// Reader position, kept by the reader (user space) between calls
+struct schedtr_cursor {
+  uint pos[NCPU]; // Next event to read from each CPU ring
+  uint lost;      // Events overwritten before this reader got to them
+};
+
+struct proc;
+void schedtr_record(int type, struct proc *p, uint npass);
+void schedtr_seek_end(struct schedtr_cursor *cur);
+int  schedtr_read(struct schedev *out, int max, struct schedtr_cursor *cur, int *consumed);
+#endif
@@ -0,0 +1,593 @@
+// sclass.c — deadline, stride, lottery and round-robin scheduler classes
+//
+// See sclass.h for the interface. Everything here runs with the lock of
+// the run queue passed in held.
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sclass.h"
+
+//PAGEBREAK: 20
+// Deadline. Earliest deadline first over constant bandwidth
+// reservations: a process gets dlruntime ticks of budget to spend by a
+// deadline dlperiod ticks out. Spending the budget postpones the
+// deadline a period and refills it, and yield() then holds the process
+// back until that reservation is due (see dl_throttle), so it never
+// takes more than its share. A waking process gets a fresh reservation
+// unless what it has left still fits in the time to its deadline at its
+// bandwidth. A deadline is missed if it passes with the process still
+// runnable. setdeadline() admits reservations only while those of a CPU
+// fit in it, so the class is pinned to the CPU that admitted them.
+
+static int
+dl_before(struct proc *a, struct proc *b)
+{
+  int d = (int)(a->dldeadline - b->dldeadline);
+
+  if(d != 0)
+    return d < 0;
+  return a->pid < b->pid;
+}
+
+static void
+dl_set(struct runq *rq, int i, struct proc *p)
+{
+  rq->dl[i] = p;
+  p->rqidx = i;
+}
+
+static void
+dl_up(struct runq *rq, int i)
+{
+  struct proc *p = rq->dl[i];
+
+  while(i > 0){
+    int up = (i - 1) / 2;
+    if(!dl_before(p, rq->dl[up]))
+      break;
+    dl_set(rq, i, rq->dl[up]);
+    i = up;
+  }
+  dl_set(rq, i, p);
+}
+
+static void
+dl_down(struct runq *rq, int i)
+{
+  struct proc *p = rq->dl[i];
+  int c;
+
+  while((c = 2*i + 1) < rq->ndl){
+    if(c + 1 < rq->ndl && dl_before(rq->dl[c+1], rq->dl[c]))
+      c++;
+    if(!dl_before(rq->dl[c], p))
+      break;
+    dl_set(rq, i, rq->dl[c]);
+    i = c;
+  }
+  dl_set(rq, i, p);
+}
+
+static void
+dl_yield(struct runq *rq, struct proc *p)
+{
+  dl_set(rq, rq->ndl++, p);
+  dl_up(rq, p->rqidx);
+}
+
+// Renew the reservation of waking p if it is over, or if the budget
+// left would run at more than p's bandwidth until the deadline.
+static void
+dl_enqueue(struct runq *rq, struct proc *p)
+{
+  int left = (int)(p->dldeadline - ticks);
+
+  if(left <= 0 ||
+     (uint)p->dlleft * p->dlperiod > ((uint)p->dlruntime << 10) * left){
+    p->dldeadline = p->dljob = ticks + p->dlperiod;
+    p->dlleft = p->dlruntime << 10;
+    p->dlmissed = 0;
+  }
+  dl_yield(rq, p);
+}
+
+static void
+dl_dequeue(struct runq *rq, struct proc *p)
+{
+  struct proc *last;
+  int i = p->rqidx;
+
+  if(i < --rq->ndl){
+    last = rq->dl[rq->ndl];
+    dl_set(rq, i, last);
+    dl_up(rq, i);
+    dl_down(rq, last->rqidx);
+  }
+  p->rqidx = -1;
+}
+
+static struct proc*
+dl_pick_next(struct runq *rq)
+{
+  struct proc *p;
+
+  if(rq->ndl == 0)
+    return 0;
+  p = rq->dl[0];
+  dl_dequeue(rq, p);
+  return p;
+}
+
+static struct proc*
+dl_peek(struct runq *rq)
+{
+  return rq->ndl > 0 ? rq->dl[0] : 0;
+}
+
+// Count a miss once p is past the deadline its job was renewed with,
+// then charge its budget, postponing the deadline a period for each
+// budget spent. A spent budget is a finished job, so the next one is
+// judged against the new deadline. p gives up the CPU on spending a
+// budget or when an earlier deadline is queued.
+static int
+dl_tick(struct runq *rq, struct proc *p, uint frac)
+{
+  int spent = 0;
+
+  if(!p->dlmissed && (int)(ticks - p->dljob) > 0){
+    p->dlmissed = 1;
+    p->dlmisses++;
+  }
+  p->dlleft -= (int)frac;
+  while(p->dlleft <= 0){
+    p->dldeadline += p->dlperiod;
+    p->dlleft += p->dlruntime << 10;
+    spent = 1;
+  }
+  if(spent){
+    p->dljob = p->dldeadline;
+    p->dlmissed = 0;
+    if(p->rqidx >= 0)
+      dl_down(rq, p->rqidx);
+  }
+  return spent || (rq->ndl > 0 && dl_before(rq->dl[0], p));
+}
+
+static struct sched_class dl_class = {
+  .name = "deadline",
+  .enqueue = dl_enqueue,
+  .dequeue = dl_dequeue,
+  .pick_next = dl_pick_next,
+  .peek = dl_peek,
+  .tick = dl_tick,
+  .yield = dl_yield,
+  .pinned = 1,
+};
+
+//PAGEBREAK: 20
+// Stride. Each queue picks the group of least pass among those with
+// processes queued on it, then that group's member of least pass, so a
+// pick costs O(log NGROUP + log NPROC). A tick advances both the process
+// by its stride and its group on that CPU by the group's.
+
+// Does a run before b? Passes are compared by their wrapping distance,
+// so they keep growing and never have to be rewritten.
+static int
+runq_before(struct proc *a, struct proc *b)
+{
+  int d = (int)(a->pass - b->pass);
+
+  if(d != 0)
+    return d < 0;
+  return a->pid < b->pid;
+}
+
+static void
+runq_set(struct gq *g, int i, struct proc *p)
+{
+  g->heap[i] = p;
+  p->rqidx = i;
+}
+
+// Move heap[i] towards the root until its parent runs before it.
+static void
+runq_up(struct gq *g, int i)
+{
+  struct proc *p = g->heap[i];
+
+  while(i > 0){
+    int up = (i - 1) / 2;
+    if(!runq_before(p, g->heap[up]))
+      break;
+    runq_set(g, i, g->heap[up]);
+    i = up;
+  }
+  runq_set(g, i, p);
+}
+
+// Move heap[i] towards the leaves until it runs before both children.
+static void
+runq_down(struct gq *g, int i)
+{
+  struct proc *p = g->heap[i];
+  int c;
+
+  while((c = 2*i + 1) < g->n){
+    if(c + 1 < g->n && runq_before(g->heap[c+1], g->heap[c]))
+      c++;
+    if(!runq_before(g->heap[c], p))
+      break;
+    runq_set(g, i, g->heap[c]);
+    i = c;
+  }
+  runq_set(g, i, p);
+}
+
+// The same for the heap of groups of a CPU, on (pass, group).
+static int
+gheap_before(struct gq *a, struct gq *b)
+{
+  int d = (int)(a->pass - b->pass);
+
+  if(d != 0)
+    return d < 0;
+  return a < b;
+}
+
+static void
+gheap_set(struct runq *rq, int i, struct gq *g)
+{
+  rq->gheap[i] = g;
+  g->gidx = i;
+}
+
+static void
+gheap_up(struct runq *rq, int i)
+{
+  struct gq *g = rq->gheap[i];
+
+  while(i > 0){
+    int up = (i - 1) / 2;
+    if(!gheap_before(g, rq->gheap[up]))
+      break;
+    gheap_set(rq, i, rq->gheap[up]);
+    i = up;
+  }
+  gheap_set(rq, i, g);
+}
+
+static void
+gheap_down(struct runq *rq, int i)
+{
+  struct gq *g = rq->gheap[i];
+  int c;
+
+  while((c = 2*i + 1) < rq->ng){
+    if(c + 1 < rq->ng && gheap_before(rq->gheap[c+1], rq->gheap[c]))
+      c++;
+    if(!gheap_before(rq->gheap[c], g))
+      break;
+    gheap_set(rq, i, rq->gheap[c]);
+    i = c;
+  }
+  gheap_set(rq, i, g);
+}
+
+// Take gheap[i] out of the heap of groups.
+static void
+gheap_del(struct runq *rq, int i)
+{
+  struct gq *g = rq->gheap[i], *last;
+
+  if(i < --rq->ng){
+    last = rq->gheap[rq->ng];
+    gheap_set(rq, i, last);
+    gheap_up(rq, i);
+    gheap_down(rq, last->gidx);
+  }
+  g->gidx = -1;
+}
+
+// A pass behind the base (a new process, or one that slept through a
+// rebase) starts at the base, and one more than DISTANCE_MAX ahead of
+// the queue head is pulled back to it, as the old full rebase did.
+// The same holds for the pass of p's group when it had nothing queued.
+static void
+stride_enqueue(struct runq *rq, struct proc *p)
+{
+  struct gq *g = &rq->gq[p->group];
+
+  if((int)(p->pass - g->base) < 0)
+    p->pass = g->base;
+  if(g->n > 0 && (int)(p->pass - g->heap[0]->pass) > DISTANCE_MAX)
+    p->pass = g->heap[0]->pass + DISTANCE_MAX;
+
+  runq_set(g, g->n++, p);
+  runq_up(g, p->rqidx);
+
+  if(g->gidx < 0){
+    if((int)(g->pass - rq->base) < 0)
+      g->pass = rq->base;
+    if(rq->ng > 0 && (int)(g->pass - rq->gheap[0]->pass) > DISTANCE_MAX)
+      g->pass = rq->gheap[0]->pass + DISTANCE_MAX;
+    gheap_set(rq, rq->ng++, g);
+    gheap_up(rq, g->gidx);
+  }
+}
+
+static void
+stride_dequeue(struct runq *rq, struct proc *p)
+{
+  struct gq *g = &rq->gq[p->group];
+  struct proc *last;
+  int i = p->rqidx;
+
+  if(i < --g->n){
+    last = g->heap[g->n];
+    runq_set(g, i, last);
+    runq_up(g, i);
+    runq_down(g, last->rqidx);
+  }
+  p->rqidx = -1;
+  if(g->n == 0)
+    gheap_del(rq, g->gidx);
+}
+
+// The minimum (pass, pid) process of the minimum (pass, group) group.
+// A group stays queued while it has other members queued.
+static struct proc*
+stride_pick_next(struct runq *rq)
+{
+  struct gq *g;
+  struct proc *p;
+
+  if(rq->ng == 0)
+    return 0;
+  g = rq->gheap[0];
+  p = g->heap[0];
+  stride_dequeue(rq, p);
+
+  // Rebase lazily: passes are kept relative to base, so moving the
+  // origin is all a rebase has to do.
+  if(p->pass - g->base > PASS_MAX)
+    g->base = p->pass;
+  if(g->pass - rq->base > PASS_MAX)
+    rq->base = g->pass;
+  return p;
+}
+
+static struct proc*
+stride_peek(struct runq *rq)
+{
+  return rq->ng > 0 ? rq->gheap[0]->heap[0] : 0;
+}
+
+// Advance p and its group by frac/1024 of their strides, keeping both
+// heaps in order (p may already be queued again when switched out).
+static int
+stride_tick(struct runq *rq, struct proc *p, uint frac)
+{
+  struct gq *g = &rq->gq[p->group];
+
+  p->pass += p->stride * frac >> 10;
+  if(p->rqidx >= 0)
+    runq_down(g, p->rqidx);
+  g->pass += group_stride(p->group) * frac >> 10;
+  if(g->gidx >= 0)
+    gheap_down(rq, g->gidx);
+  return 1;
+}
+
+// Carry p's pass over as its distance above the group's base.
+static void
+stride_detach(struct runq *rq, struct proc *p)
+{
+  p->pass -= rq->gq[p->group].base;
+}
+
+static void
+stride_attach(struct runq *rq, struct proc *p)
+{
+  p->pass += rq->gq[p->group].base;
+}
+
+static struct sched_class stride_class = {
+  .name = "stride",
+  .enqueue = stride_enqueue,
+  .dequeue = stride_dequeue,
+  .pick_next = stride_pick_next,
+  .peek = stride_peek,
+  .tick = stride_tick,
+  .yield = stride_enqueue,
+  .detach = stride_detach,
+  .attach = stride_attach,
+};
+
+//PAGEBREAK: 20
+// Lottery. Queued processes sit in lot[] in no order, and a Fenwick tree
+// over their tickets finds the holder of a drawn ticket in O(log NPROC).
+// A process draws with the tickets it had when queued.
+
+// Add v to the tickets of slot i.
+static void
+fen_add(struct runq *rq, int i, int v)
+{
+  for(i++; i <= NPROC; i += i & -i)
+    rq->fen[i] += v;
+}
+
+// The slot holding ticket t, 0 <= t < lottotal. NPROC must be a power
+// of two.
+static int
+fen_find(struct runq *rq, int t)
+{
+  int pos = 0;
+
+  for(int step = NPROC; step > 0; step >>= 1){
+    if(pos + step <= NPROC && rq->fen[pos + step] <= t){
+      pos += step;
+      t -= rq->fen[pos];
+    }
+  }
+  return pos;
+}
+
+// xorshift32, seeded per queue
+static uint
+lottery_rand(struct runq *rq)
+{
+  uint x = rq->seed;
+
+  if(x == 0)
+    x = 2463534242U ^ (uint)rq;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  rq->seed = x;
+  return x;
+}
+
+static void
+lot_set(struct runq *rq, int i, struct proc *p, int t)
+{
+  rq->lot[i] = p;
+  rq->lott[i] = t;
+  p->rqidx = i;
+}
+
+static void
+lottery_enqueue(struct runq *rq, struct proc *p)
+{
+  int t = sched_tickets(p);
+
+  lot_set(rq, rq->nlot, p, t);
+  fen_add(rq, rq->nlot++, t);
+  rq->lottotal += t;
+}
+
+// Fill p's slot with the last one.
+static void
+lottery_dequeue(struct runq *rq, struct proc *p)
+{
+  int i = p->rqidx, last = --rq->nlot;
+
+  fen_add(rq, i, -rq->lott[i]);
+  rq->lottotal -= rq->lott[i];
+  if(i != last){
+    struct proc *q = rq->lot[last];
+    int t = rq->lott[last];
+    fen_add(rq, last, -t);
+    fen_add(rq, i, t);
+    lot_set(rq, i, q, t);
+  }
+  p->rqidx = -1;
+}
+
+static struct proc*
+lottery_pick_next(struct runq *rq)
+{
+  struct proc *p;
+
+  if(rq->nlot == 0)
+    return 0;
+  p = rq->lot[fen_find(rq, lottery_rand(rq) % rq->lottotal)];
+  lottery_dequeue(rq, p);
+  return p;
+}
+
+static struct proc*
+lottery_peek(struct runq *rq)
+{
+  return rq->nlot > 0 ? rq->lot[0] : 0;
+}
+
+static int
+lottery_tick(struct runq *rq, struct proc *p, uint frac)
+{
+  return 1;
+}
+
+static struct sched_class lottery_class = {
+  .name = "lottery",
+  .enqueue = lottery_enqueue,
+  .dequeue = lottery_dequeue,
+  .pick_next = lottery_pick_next,
+  .peek = lottery_peek,
+  .tick = lottery_tick,
+  .yield = lottery_enqueue,
+};
+
+//PAGEBREAK: 20
+// Round-robin. A FIFO through p->rqnext/rqprev; rqidx is 0 while queued.
+
+static void
+rr_enqueue(struct runq *rq, struct proc *p)
+{
+  p->rqnext = 0;
+  p->rqprev = rq->rrtail;
+  if(rq->rrtail)
+    rq->rrtail->rqnext = p;
+  else
+    rq->rrhead = p;
+  rq->rrtail = p;
+  p->rqidx = 0;
+}
+
+static void
+rr_dequeue(struct runq *rq, struct proc *p)
+{
+  if(p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    rq->rrhead = p->rqnext;
+  if(p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  else
+    rq->rrtail = p->rqprev;
+  p->rqnext = p->rqprev = 0;
+  p->rqidx = -1;
+}
+
+static struct proc*
+rr_pick_next(struct runq *rq)
+{
+  struct proc *p = rq->rrhead;
+
+  if(p)
+    rr_dequeue(rq, p);
+  return p;
+}
+
+static struct proc*
+rr_peek(struct runq *rq)
+{
+  return rq->rrhead;
+}
+
+// A tick is a whole slice.
+static int
+rr_tick(struct runq *rq, struct proc *p, uint frac)
+{
+  return 1;
+}
+
+static struct sched_class rr_class = {
+  .name = "rr",
+  .enqueue = rr_enqueue,
+  .dequeue = rr_dequeue,
+  .pick_next = rr_pick_next,
+  .peek = rr_peek,
+  .tick = rr_tick,
+  .yield = rr_enqueue,
+};
+
+// By SCHED_* id, which is also the order classes are picked from.
+struct sched_class *sched_classes[NSCHED] = {
+  [SCHED_DEADLINE] &dl_class,
+  [SCHED_STRIDE]   &stride_class,
+  [SCHED_LOTTERY]  &lottery_class,
+  [SCHED_RR]       &rr_class,
+};
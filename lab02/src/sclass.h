@@ -0,0 +1,88 @@
+// Scheduler classes and per-CPU run queues.
+//
+// Every process belongs to one scheduler class (p->sclass, SCHED_*),
+// which decides the order its RUNNABLE processes run in. Each CPU's run
+// queue holds the queue state of every class; a CPU runs the first class
+// in sched_classes[] that has anything queued. proc.c keeps the counts
+// and loads common to all classes and does the locking, stealing and
+// balancing; the class operations are called with the queue lock held:
+//
+//   enqueue(rq, p)    queue p, which has just become RUNNABLE
+//   dequeue(rq, p)    take queued p off rq
+//   pick_next(rq)     take the process to run next off rq, or return 0
+//   peek(rq)          the process pick_next would take, left queued
+//   tick(rq, p, f)    charge running p for f/1024 of a tick on rq;
+//                     return whether it should give up the CPU
+//   yield(rq, p)      queue p, which gives up the CPU still RUNNABLE
+//   detach(rq, p)     p, just taken off rq, is moving to another CPU
+//   attach(rq, p)     ... and is about to be queued on or run from rq
+//
+// The processes of a pinned class are never stolen or balanced away.
+//
+// Deadline (sclass.c) runs reservations earliest deadline first, ahead
+// of every other class; stride is the two-level stride scheduler with
+// ticket groups; lottery draws a ticket among the queued processes
+// through a Fenwick tree; round-robin runs its processes in FIFO order a
+// tick at a time. Groups and stride passes mean nothing to the other
+// classes.
+
+// The processes of one group queued on one CPU (stride)
+struct gq {
+  struct proc *heap[NPROC];     // RUNNABLE members, min-heap on (pass, pid)
+  int n;                        // Number of processes in heap
+  uint base;                    // Member pass origin, moved instead of rebasing
+  uint pass;                    // Pass of the group on this CPU
+  int gidx;                     // Index in the heap of groups, -1 if not queued
+};
+
+struct runq {
+  struct spinlock lock;
+  int n;                        // Number of processes queued, all classes
+  int load;                     // Weights of the queued processes
+  int running;                  // Weight of the process on this CPU
+  uint balanced;                // ticks at the last balance
+  volatile int idle;            // Set while this CPU is halted for want of work
+
+  // deadline
+  struct proc *dl[NPROC];       // Queued processes, min-heap on (deadline, pid)
+  int ndl;                      // Number of processes in dl
+  int dlutil;                   // Utilization admitted here, in 1/1024ths;
+                                // guarded by the ptable lock
+
+  // stride
+  struct gq gq[NGROUP];         // Queued processes by group
+  struct gq *gheap[NGROUP];     // Groups with processes queued, min-heap on pass
+  int ng;                       // Number of groups in gheap
+  uint base;                    // Group pass origin
+
+  // lottery
+  struct proc *lot[NPROC];      // Queued processes, in no order
+  int lott[NPROC];              // ... and the tickets each was queued with
+  int fen[NPROC + 1];           // Fenwick tree of lott[], 1-based
+  int nlot;                     // Number of processes in lot[]
+  int lottotal;                 // Sum of lott[]
+  uint seed;                    // Draws
+
+  // round-robin
+  struct proc *rrhead;          // FIFO of queued processes, through rqnext
+  struct proc *rrtail;
+};
+
+struct sched_class {
+  char *name;
+  void (*enqueue)(struct runq*, struct proc*);
+  void (*dequeue)(struct runq*, struct proc*);
+  struct proc* (*pick_next)(struct runq*);
+  struct proc* (*peek)(struct runq*);
+  int (*tick)(struct runq*, struct proc*, uint);
+  void (*yield)(struct runq*, struct proc*);
+  void (*detach)(struct runq*, struct proc*);
+  void (*attach)(struct runq*, struct proc*);
+  int pinned;
+};
+
+extern struct sched_class *sched_classes[NSCHED];
+
+// proc.c
+uint group_stride(int gid);
+int sched_tickets(struct proc *p);
@@ -104,6 +104,23 @@ extern int sys_wait(void);
 extern int sys_write(void);
 extern int sys_uptime(void);
 extern int sys_settickets(void); // New system call for settickets
+extern int sys_yield(void); // New system call for yield
+extern int sys_cpustat(void); // New system call for cpustat
+extern int sys_sched_trace_read(void); // New system call for sched_trace_read
+extern int sys_grpcreate(void); // New system call for grpcreate
+extern int sys_grptickets(void); // New system call for grptickets
+extern int sys_setgroup(void); // New system call for setgroup
+extern int sys_schedcharge(void); // New system call for schedcharge
+extern int sys_setsched(void); // New system call for setsched
+extern int sys_setdeadline(void); // New system call for setdeadline
+extern int sys_dlstat(void); // New system call for dlstat
+extern int sys_setaffinity(void); // New system call for setaffinity
+extern int sys_getaffinity(void); // New system call for getaffinity
+extern int sys_get_procinfo(void); // New system call for get_procinfo
+extern int sys_schedstat(void); // New system call for schedstat
+extern int sys_uptime_us(void); // New system call for uptime_us
+extern int sys_timerinfo(void); // New system call for timerinfo
+extern int sys_settickless(void); // New system call for settickless
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -128,6 +145,23 @@ static int (*syscalls[])(void) = {
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
 [SYS_settickets] sys_settickets, // New system call for settickets
+[SYS_yield] sys_yield, // New system call for yield
+[SYS_cpustat] sys_cpustat, // New system call for cpustat
+[SYS_sched_trace_read] sys_sched_trace_read, // New system call for sched_trace_read
+[SYS_grpcreate] sys_grpcreate, // New system call for grpcreate
+[SYS_grptickets] sys_grptickets, // New system call for grptickets
+[SYS_setgroup] sys_setgroup, // New system call for setgroup
+[SYS_schedcharge] sys_schedcharge, // New system call for schedcharge
+[SYS_setsched] sys_setsched, // New system call for setsched
+[SYS_setdeadline] sys_setdeadline, // New system call for setdeadline
+[SYS_dlstat] sys_dlstat, // New system call for dlstat
+[SYS_setaffinity] sys_setaffinity, // New system call for setaffinity
+[SYS_getaffinity] sys_getaffinity, // New system call for getaffinity
+[SYS_get_procinfo] sys_get_procinfo, // New system call for get_procinfo
+[SYS_schedstat] sys_schedstat, // New system call for schedstat
+[SYS_uptime_us] sys_uptime_us, // New system call for uptime_us
+[SYS_timerinfo] sys_timerinfo, // New system call for timerinfo
+[SYS_settickless] sys_settickless, // New system call for settickless
 };
 
 void
@@ -20,4 +20,21 @@
 #define SYS_link   19
 #define SYS_mkdir  20
 #define SYS_close  21
-#define SYS_settickets 22 // New system call number for settickets
\ No newline at end of file
+#define SYS_settickets 22 // New system call number for settickets
+#define SYS_yield 23 // New system call number for yield
+#define SYS_cpustat 24 // New system call number for cpustat
+#define SYS_sched_trace_read 25 // New system call number for sched_trace_read
+#define SYS_grpcreate 26 // New system call number for grpcreate
+#define SYS_grptickets 27 // New system call number for grptickets
+#define SYS_setgroup 28 // New system call number for setgroup
+#define SYS_schedcharge 29 // New system call number for schedcharge
+#define SYS_setsched 30 // New system call number for setsched
+#define SYS_setdeadline 31 // New system call number for setdeadline
+#define SYS_dlstat 32 // New system call number for dlstat
+#define SYS_setaffinity 33 // New system call number for setaffinity
+#define SYS_getaffinity 34 // New system call number for getaffinity
+#define SYS_get_procinfo 35 // New system call number for get_procinfo
+#define SYS_schedstat 36 // New system call number for schedstat
+#define SYS_uptime_us 37 // New system call number for uptime_us
+#define SYS_timerinfo 38 // New system call number for timerinfo
+#define SYS_settickless 39 // New system call number for settickless
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "schedtrace.h" // for the scheduler trace rings
 
 int
 sys_fork(void)
@@ -71,6 +72,7 @@ sys_sleep(void)
       release(&tickslock);
       return -1;
     }
+    tickwait(ticks0 + n);
     sleep(&ticks, &tickslock);
   }
   release(&tickslock);
@@ -84,6 +86,7 @@ sys_uptime(void)
 {
   uint xticks;
 
+  tickupdate();
   acquire(&tickslock);
   xticks = ticks;
   release(&tickslock);
@@ -103,11 +106,246 @@ sys_settickets(void)
   if(tickets < 1 || tickets > (STRIDE_MAX -1)) return -1;
 
   // Set the number of tickets and end_ticks for the process
-  p->tickets = tickets;
-  p->stride = STRIDE_MAX / tickets;
+  settickets(tickets);
 
   // Set end_ticks only if it is valid
   if(end_ticks >= 1) p->end_ticks = end_ticks;
   
   return 0;
+}
+
+// New system call for the scheduler benchmarks
+int
+sys_yield(void)
+{
+  myproc()->yielded = 1;
+  yield();
+  return 0;
+}
+
+// New system call for idle CPU statistics: copy up to max per-CPU
+// counters to buf and return the number of CPUs
+int
+sys_cpustat(void)
+{
+  struct cpustat *buf;
+  int max, i;
+
+  if(argint(1, &max) < 0 || max < 0) return -1;
+  if(max > ncpu) max = ncpu;
+  if(argptr(0, (void*)&buf, max * sizeof(*buf)) < 0) return -1;
+
+  for(i = 0; i < max; i++){
+    buf[i].ticks = cpus[i].nticks;
+    buf[i].idle  = cpus[i].nidle;
+    buf[i].locks = cpus[i].nlock;
+    buf[i].halts = cpus[i].nhalt;
+    buf[i].ipis  = cpus[i].nipi;
+  }
+  return ncpu;
+}
+
+// New system call for the scheduler trace: stream events since *cursor.
+// With n == 0 the cursor is moved to the current end of the trace.
+int
+sys_sched_trace_read(void)
+{
+  int uaddr, max;
+  char *ucur;
+  struct schedtr_cursor cur;
+  struct schedev kbuf[16];
+  int total = 0;
+
+  if(argint(0, &uaddr) < 0) return -1;
+  if(argint(1, &max) < 0) return -1;
+  if(argptr(2, &ucur, sizeof(cur)) < 0) return -1;
+  if(max < 0) return -1;
+  memmove(&cur, ucur, sizeof(cur));
+  if(max == 0)
+    schedtr_seek_end(&cur);
+
+  // copy out in chunks until the rings are drained or the buffer is full
+  while(total < max){
+    int want = max - total, consumed;
+    if(want > NELEM(kbuf)) want = NELEM(kbuf);
+    int k = schedtr_read(kbuf, want, &cur, &consumed);
+    if(consumed == 0) break;
+    if(k > 0 && copyout(myproc()->pgdir, (uint)(uaddr + total * sizeof(struct schedev)),
+                        (void*)kbuf, k * sizeof(struct schedev)) < 0)
+      return -1;
+    total += k;
+  }
+
+  // hand the cursor back
+  if(copyout(myproc()->pgdir, (uint)ucur, (void*)&cur, sizeof(cur)) < 0) return -1;
+  return total;
+}
+
+// New system call for ticket groups: create a group with the given tickets
+int
+sys_grpcreate(void)
+{
+  int tickets;
+
+  if(argint(0, &tickets) < 0) return -1;
+  if(tickets < 1 || tickets > (STRIDE_MAX -1)) return -1;
+  return grpcreate(tickets);
+}
+
+// New system call for ticket groups: set the tickets of a group
+int
+sys_grptickets(void)
+{
+  int gid, tickets;
+
+  if(argint(0, &gid) < 0 || argint(1, &tickets) < 0) return -1;
+  if(tickets < 1 || tickets > (STRIDE_MAX -1)) return -1;
+  return grptickets(gid, tickets);
+}
+
+// New system call for ticket groups: move a process to a group
+int
+sys_setgroup(void)
+{
+  int pid, gid;
+
+  if(argint(0, &pid) < 0 || argint(1, &gid) < 0) return -1;
+  return setgroup(pid, gid);
+}
+
+// New system call for partial-quantum charging: set the charging mode
+int
+sys_schedcharge(void)
+{
+  int mode;
+
+  if(argint(0, &mode) < 0) return -1;
+  return schedcharge(mode);
+}
+
+// New system call for scheduler classes: put a process, or with pid 0
+// every process, in a class
+int
+sys_setsched(void)
+{
+  int pid, cls;
+
+  if(argint(0, &pid) < 0 || argint(1, &cls) < 0) return -1;
+  return setsched(pid, cls);
+}
+
+// New system call for the deadline class: like settickets, but reserve
+// runtime ticks every period ticks (runtime 0: back to stride)
+int
+sys_setdeadline(void)
+{
+  int runtime, period, end_ticks;
+  struct proc *p = myproc();
+
+  if(argint(0, &runtime) < 0 || argint(1, &period) < 0 || argint(2, &end_ticks) < 0) return -1;
+  if(runtime < 0 || (runtime > 0 && (period < runtime || period > DL_PERIOD_MAX))) return -1;
+  if(setdeadline(runtime, period) < 0) return -1;
+
+  // Set end_ticks only if it is valid
+  if(end_ticks >= 1) p->end_ticks = end_ticks;
+  return 0;
+}
+
+// New system call for the deadline class: deadline state and misses
+// of a process
+int
+sys_dlstat(void)
+{
+  int pid;
+  struct dlstat *st;
+
+  if(argint(0, &pid) < 0) return -1;
+  if(argptr(1, (void*)&st, sizeof(*st)) < 0) return -1;
+  return dlstat(pid, st);
+}
+
+// New system call for CPU affinity: let a process run only on the CPUs
+// in mask; returns the old mask
+int
+sys_setaffinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0) return -1;
+  return setaffinity(pid, (uint)mask);
+}
+
+// New system call for CPU affinity: mask, last CPU and migrations of
+// a process
+int
+sys_getaffinity(void)
+{
+  int pid;
+  struct affinity *a;
+
+  if(argint(0, &pid) < 0) return -1;
+  if(argptr(1, (void*)&a, sizeof(*a)) < 0) return -1;
+  return getaffinity(pid, a);
+}
+
+// get_procinfo system call: pid <= 0 is "self". Besides lab01's fields,
+// the scheduler class, tickets, last CPU, switch counts and waits
+int
+sys_get_procinfo(void)
+{
+  int pid;
+  char *uaddr;
+  struct procinfo info;
+
+  if(argint(0, &pid) < 0) return -1;
+  if(argptr(1, &uaddr, sizeof(info)) < 0) return -1;
+  if(getprocinfo(pid, &info) < 0) return -1;
+
+  // copy to user space
+  if(copyout(myproc()->pgdir, (uint)uaddr, (void*)&info, sizeof(info)) < 0) return -1;
+  return 0;
+}
+
+// New system call for scheduler statistics: switch counts and waits of
+// every CPU together; returns the number of CPUs
+int
+sys_schedstat(void)
+{
+  struct schedstat *st;
+
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0) return -1;
+  return schedstat(st);
+}
+
+// New system call for microseconds since boot, wrapping after 71 minutes
+int
+sys_uptime_us(void)
+{
+  return uptimeus();
+}
+
+// New system call for the timer settings and calibration
+int
+sys_timerinfo(void)
+{
+  struct timerinfo *ti;
+
+  if(argptr(0, (void*)&ti, sizeof(*ti)) < 0) return -1;
+  ti->hz = HZ;
+  ti->uspertick = USPERTICK;
+  ti->lapicpertick = lapicpertick;
+  ti->tscpertick = tscpertick;
+  ti->tickless = settickless(-1);
+  return 0;
+}
+
+// New system call to turn dynamic ticks on (1) or off (0), or with -1
+// just read the setting; returns the previous one
+int
+sys_settickless(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0) return -1;
+  return settickless(on);
 }
\ No newline at end of file
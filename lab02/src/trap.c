@@ -13,6 +13,8 @@ struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
+uint tickstsc;     // Time stamp counter at the start of tick ticks
+uint tickswake;    // First tick a process sleeping on ticks waits for
 
 void
 tvinit(void)
@@ -24,6 +26,59 @@ tvinit(void)
   SETGATE(idt[T_SYSCALL], 1, SEG_KCODE<<3, vectors[T_SYSCALL], DPL_USER);
 
   initlock(&tickslock, "time");
+  tickstsc = rdtsc_lo();
+}
+
+// Bring ticks up to date with the time stamp counter, and wake the
+// processes sleeping on it once the first tick one waits for has come.
+// Every CPU's timer interrupt does this, so the clock keeps going on
+// whichever timers are not stopped (see sched_timer).
+void
+tickupdate(void)
+{
+  uint n;
+
+  acquire(&tickslock);
+  if((n = (rdtsc_lo() - tickstsc) / tscpertick) > 0){
+    ticks += n;
+    tickstsc += n * tscpertick;
+    if((int)(ticks - tickswake) >= 0){
+      tickswake = ticks + TICKLESSMAX;
+      wakeup(&ticks);
+    }
+  }
+  release(&tickslock);
+}
+
+// The caller, holding tickslock, is about to sleep on ticks until tick
+// t. CPU 0 stops its timer no later than tickswake; if it has already
+// stopped it past t, it is sent a reschedule IPI to arm it again.
+void
+tickwait(uint t)
+{
+  if((int)(t - tickswake) < 0){
+    tickswake = t;
+    if(cpuid() != 0 && (int)(cpus[0].timerat - t) > 0)
+      lapicipi(cpus[0].apicid, T_RESCHED);
+  }
+}
+
+// Microseconds since boot, wrapping after 71 minutes: whole ticks, plus
+// the time stamp counter cycles since the last one, never a whole
+// tick's worth so the clock does not run back.
+uint
+uptimeus(void)
+{
+  uint us;
+
+  tickupdate();
+  acquire(&tickslock);
+  us = (rdtsc_lo() - tickstsc) / (tscpertick / USPERTICK);
+  if(us >= USPERTICK)
+    us = USPERTICK - 1;
+  us += ticks * USPERTICK;
+  release(&tickslock);
+  return us;
 }
 
 void
@@ -48,12 +103,18 @@ trap(struct trapframe *tf)
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
-    if(cpuid() == 0){
-      acquire(&tickslock);
-      ticks++;
-      wakeup(&ticks);
-      release(&tickslock);
-    }
+    mycpu()->nticks++;
+    if(myproc() == 0)
+      mycpu()->nidle++;
+    tickupdate();
+    lapiceoi();
+    break;
+  case T_RESCHED:
+    // An idle CPU was woken to look at the run queues, which the
+    // scheduler loop does once we return, or a busy one to run a
+    // deadline process, move its process elsewhere, see it killed or
+    // arm its stopped timer sooner, by yielding below.
+    mycpu()->nipi++;
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
@@ -105,23 +166,37 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER){
     struct proc *p = myproc();
 
-    // update ticks for the process
-    p->ticks++;
+    // update ticks for the process: those since it was last counted,
+    // several if its timer was stopped, but at least this one
+    uint n = ticks - p->tickin;
+    if(n == 0)
+      n = 1;
+    p->ticks += n;
+    p->tickin = ticks;
 
-    // Debug log for scheduler test at each scheduling
-    if(p->pid > 2 && p->parent && p->parent->pid > 2)
-      cprintf("Process %d selected, stride : %d, ticket : %d, pass : %d -> %d  (%d/%d)\n",
-              p->pid, p->stride, p->tickets, p->pass, p->pass+p->stride, p->ticks, p->end_ticks);  
-    
-    // update pass for the process
-    p->pass += p->stride;
+    // charge the process by its scheduler class, and trace it for
+    // the scheduler test (see schedlog)
+    int preempt = sched_charge(p, n);
 
     // If end_ticks is set, check it and exit if the process has run enough
     if(p->end_ticks > 0 && p->ticks >= p->end_ticks) exit();
 
-    // yield the CPU
-    yield();
+    // yield the CPU if its class says so
+    if(preempt)
+      yield();
   }
+
+  // A deadline process was queued on this CPU (see runq_preempt), the
+  // running process may no longer run here (see setaffinity), or the
+  // timer is wanted sooner (see runq_kick and tickwait), which the
+  // switch back in sees to.
+  if(myproc() && myproc()->state == RUNNING && tf->trapno == T_RESCHED)
+    yield();
+
+  // The timer is one-shot: arm it for the next tick it is wanted.
+  if(tf->trapno == T_IRQ0+IRQ_TIMER)
+    sched_timer(0);
+
   // Check if the process has been killed since we yielded
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
@@ -39,4 +39,101 @@ void free(void*);
 int atoi(const char*);
 
 // New system calls for project 2
-int settickets(int tickets, int end_ticks); // set number of tickets and end_ticks for the process
\ No newline at end of file
+int settickets(int tickets, int end_ticks); // set number of tickets and end_ticks for the process
+int yield(void); // give up the CPU for one scheduling round
+
+// Per-CPU scheduler counters
+struct cpustat{
+    uint ticks;            // Timer ticks taken
+    uint idle;             // ... with no process running
+    uint locks;            // Run queue lock acquisitions by the scheduler
+    uint halts;            // Idle halts
+    uint ipis;             // Reschedule IPIs received
+};
+int cpustat(struct cpustat *buf, int max); // returns the number of CPUs
+
+// Scheduler trace events
+#define SCHEDEV_IN   1     // switched in by the scheduler
+#define SCHEDEV_OUT  2     // switched back out; npass holds the new state
+#define SCHEDEV_TICK 3     // timer tick charged: pass -> npass
+#define SCHEDEV_FORK 4     // created by fork()
+#define SCHEDEV_EXIT 5     // exit()
+struct schedev{
+    uint seq;              // Global sequence number
+    uint tick;             // Tick of the event
+    ushort cpu;            // CPU that logged it
+    ushort type;           // SCHEDEV_*
+    int pid;               // Process
+    int ppid;              // Its parent (0 if none)
+    int tickets;           // Tickets at the event
+    uint stride;           // Stride at the event
+    uint pass;             // Pass relative to the queue base
+    uint npass;            // TICK: pass after the charge; OUT: procstate after
+    int ticks;             // Ticks run so far
+    int end_ticks;         // Tick budget (-1 if none)
+};
+struct schedtr_cursor{
+    uint pos[8];           // Per-CPU read position (NCPU); zero to start
+    uint lost;             // Events overwritten before they were read
+};
+int sched_trace_read(struct schedev *buf, int n, struct schedtr_cursor *cursor); // n == 0: seek to end
+int grpcreate(int tickets); // New group with tickets; returns its id
+int grptickets(int gid, int tickets);
+int setgroup(int pid, int gid);
+#define CHARGE_TICK  0     // a whole stride per timer tick
+#define CHARGE_EXACT 1     // by time stamp counter cycles run (default)
+#define CHARGE_COMP  2     // ... plus compensation tickets
+int schedcharge(int mode); // returns the previous mode
+#define SCHED_DEADLINE 0
+#define SCHED_STRIDE   1
+#define SCHED_LOTTERY  2
+#define SCHED_RR       3
+int setsched(int pid, int cls); // pid 0: every process; returns the old class
+struct dlstat{
+    int runtime;           // Budget per period in ticks, 0 if not in the class
+    int period;            // Period and relative deadline in ticks
+    uint misses;           // Deadlines passed with the process still runnable
+};
+int setdeadline(int runtime, int period, int end_ticks); // runtime 0: back to stride; -1 if not admitted
+int dlstat(int pid, struct dlstat *st);
+struct affinity{
+    uint mask;             // CPUs it may run on, one bit each
+    int cpu;               // CPU it last ran on, -1 if it has not run
+    uint migrations;       // Moves to another CPU's run queue
+};
+int setaffinity(int pid, uint mask); // returns the old mask
+int getaffinity(int pid, struct affinity *a);
+#define NWAITHIST 16       // under 1/1024 tick, then powers of two of 1/1024 ticks
+struct schedstat{
+    uint nvcsw;            // Switches out by blocking or yield()
+    uint nivcsw;           // ... by preemption
+    uint nwait;            // Waits from being queued to running
+    uint waitsum;          // ... their total, in 1/1024 ticks
+    uint waitmax;          // ... the longest
+    uint waithist[NWAITHIST]; // ... by length
+};
+int schedstat(struct schedstat *st); // all CPUs together; returns the number of CPUs
+struct procinfo{
+    int pid;               // Process ID
+    int ppid;              // Parent process ID
+    int state;             // procstate value
+    uint sz;               // Address-space size
+    char name[16];         // Process name
+    int sclass;            // Scheduler class (SCHED_*)
+    int tickets;           // Tickets
+    int cpu;               // CPU it last ran on, -1 if it has not run
+    struct schedstat stat; // Its switches and waits
+};
+int get_procinfo(int pid, struct procinfo *info); // pid <= 0 is "self"
+
+// The timer
+struct timerinfo{
+    int hz;                // Ticks a second
+    uint uspertick;        // Microseconds per tick
+    uint lapicpertick;     // LAPIC timer counts per tick
+    uint tscpertick;       // Time stamp counter cycles per tick
+    int tickless;          // Dynamic ticks on
+};
+uint uptime_us(void); // microseconds since boot, wrapping after 71 minutes
+int timerinfo(struct timerinfo *ti);
+int settickless(int on); // dynamic ticks 1 on, 0 off, -1 unchanged; returns the previous setting
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define MAXHOG 16
+#define LOW 10          // tickets of the producer, child and hogs
+
+static void
+burn(int units)
+{
+  for(int u = 0; u < units; u++)
+    benchspin(10000);
+}
+
+// hog: compete at LOW tickets until killed
+static void
+hog(void)
+{
+  if(settickets(LOW, 0) < 0) fail("settickets");
+  for(;;)
+    burn(1);
+}
+
+// producer | consumer: the consumer, at the given tickets, blocks on the
+// pipe while the LOW-ticket producer does work units per item. Prints
+// the ticks to move n items through.
+static void
+pipeline(int tickets, int n, int work)
+{
+  int fd[2], pid, item, start;
+
+  if(pipe(fd) < 0) fail("pipe");
+  if((pid = fork()) < 0) fail("fork");
+  if(pid == 0){
+    close(fd[0]);
+    if(settickets(LOW, 0) < 0) fail("settickets");
+    for(item = 0; item < n; item++){
+      burn(work);
+      if(write(fd[1], &item, sizeof(item)) != sizeof(item)) fail("write");
+    }
+    exit();
+  }
+  close(fd[1]);
+  if(settickets(tickets, 0) < 0) fail("settickets");
+  start = uptime();
+  for(int i = 0; i < n; i++)
+    if(read(fd[0], &item, sizeof(item)) != sizeof(item) || item != i) fail("read");
+  int t = uptime() - start;
+  close(fd[0]);
+  wait();
+  printf(1, "pipe\t%d\t%d\t%d\t%d\n", tickets, n, t, t * 1000 / n);
+  exit();
+}
+
+// The parent, at the given tickets, waits for a LOW-ticket child doing
+// n items' worth of work.
+static void
+waiter(int tickets, int n, int work)
+{
+  int pid, start;
+
+  if(settickets(tickets, 0) < 0) fail("settickets");
+  start = uptime();
+  if((pid = fork()) < 0) fail("fork");
+  if(pid == 0){
+    if(settickets(LOW, 0) < 0) fail("settickets");
+    burn(n * work);
+    exit();
+  }
+  wait();
+  int t = uptime() - start;
+  printf(1, "wait\t%d\t%d\t%d\t%d\n", tickets, n, t, t * 1000 / n);
+  exit();
+}
+
+// run f in a child of its own so each case starts from fresh tickets
+static void
+run(void (*f)(int, int, int), int tickets, int n, int work)
+{
+  int pid = fork();
+
+  if(pid < 0) fail("fork");
+  if(pid == 0)
+    f(tickets, n, work);
+  wait();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = 200;          // items
+  int work = 20;        // work units per item
+  int nhog = 4;
+  int high = 400;       // tickets of the blocked process in the second run
+  int hogs[MAXHOG];
+  int i;
+
+  benchinit("xferbench", "[-n items] [-w work] [-h hogs] [-T tickets]");
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-' || i + 1 >= argc) usage();
+    if(argv[i][1] == 'n') n = atoi(argv[++i]);
+    else if(argv[i][1] == 'w') work = atoi(argv[++i]);
+    else if(argv[i][1] == 'h') nhog = atoi(argv[++i]);
+    else if(argv[i][1] == 'T') high = atoi(argv[++i]);
+    else usage();
+  }
+  if(n <= 0 || work <= 0 || nhog < 0 || nhog > MAXHOG || high <= LOW) usage();
+
+  for(i = 0; i < nhog; i++){
+    if((hogs[i] = fork()) < 0) fail("fork");
+    if(hogs[i] == 0)
+      hog();
+  }
+
+  // Without transfer a blocked process's tickets do nothing, so both
+  // rows of a case would take as long; with it the second is faster.
+  printf(1, "[xferbench] %d hogs at %d tickets, %d items of %d units\n",
+         nhog, LOW, n, work);
+  printf(1, "[case]\t[tickets]\t[items]\t[ticks]\t[ticks/1000 items]\n");
+  run(pipeline, LOW, n, work);
+  run(pipeline, high, n, work);
+  run(waiter, LOW, n, work);
+  run(waiter, high, n, work);
+
+  for(i = 0; i < nhog; i++)
+    kill(hogs[i]);
+  for(i = 0; i < nhog; i++)
+    wait();
+  exit();
+}
@@ -0,0 +1,28 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+static char *benchname = "bench";
+static char *benchargs = "";
+
+void
+benchinit(char *name, char *args)
+{
+  benchname = name;
+  benchargs = args;
+}
+
+void
+usage(void)
+{
+  printf(1, "usage: %s %s\n", benchname, benchargs);
+  exit();
+}
+
+void
+fail(const char *s)
+{
+  printf(1, "[%s] FAIL: %s\n", benchname, s);
+  exit();
+}
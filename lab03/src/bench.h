@@ -0,0 +1,7 @@
+// Harness shared by the benchmark and test programs (bench.c, part of
+// ULIB). A program names itself with benchinit() before anything can
+// fail; usage() and fail() then print under that name and exit.
+
+void benchinit(char *name, char *args);
+void usage(void);
+void fail(const char *s);
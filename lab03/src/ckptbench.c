@@ -0,0 +1,110 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define PGSZ 4096
+
+// checkpoint + discard, iters times
+static int
+bench_checkpoint(int iters)
+{
+  int t0 = uptime();
+  for(int i = 0; i < iters; i++){
+    int id = mcheckpoint();
+    if(id <= 0) fail("mcheckpoint");
+    if(mdiscard(id) < 0) fail("mdiscard");
+  }
+  return uptime() - t0;
+}
+
+// full copy of the heap region into dst, iters times
+static int
+bench_copy(char *dst, char *src, int pages, int iters)
+{
+  int t0 = uptime();
+  for(int i = 0; i < iters; i++)
+    memmove(dst, src, pages * PGSZ);
+  return uptime() - t0;
+}
+
+// dirty `dirty` pages then restore, iters times. Everything in the address
+// space rolls back on restore, so the loop state lives in a pipe.
+static int
+bench_restore(char *base, int pages, int dirty, int iters)
+{
+  int fds[2];
+  int st[2];  // st[0] = checkpoint id, st[1] = restores done
+
+  if(pipe(fds) < 0) fail("pipe");
+
+  int t0 = uptime();
+  int id = mcheckpoint();
+  if(id < 0) fail("mcheckpoint");
+  if(id > 0){
+    st[0] = id;
+    st[1] = 0;
+  }else{
+    if(read(fds[0], st, sizeof(st)) != sizeof(st)) fail("read state");
+  }
+
+  if(st[1] < iters){
+    for(int p = 0; p < dirty; p++)
+      base[p * PGSZ] = (char)~base[p * PGSZ];
+    st[1]++;
+    if(write(fds[1], st, sizeof(st)) != sizeof(st)) fail("write state");
+    mrestore(st[0]);
+    fail("mrestore");
+  }
+  int t = uptime() - t0;
+
+  // every dirtied page must be back to its checkpointed contents
+  for(int p = 0; p < pages; p++)
+    if(base[p * PGSZ] != (char)(p & 0x7f))
+      fail("page content not restored");
+
+  mdiscard(st[0]);
+  close(fds[0]);
+  close(fds[1]);
+  return t;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pages = 512;  // 2MB heap
+  int dirty = 16;   // pages written between restores
+  int iters = 100;
+  int i;
+
+  benchinit("ckptbench", "[-n pages] [-d dirty] [-i iters]");
+  for(i = 1; i < argc; i++){
+    char *a = argv[i];
+    if(a[0] != '-' || i + 1 >= argc) usage();
+    if(a[1] == 'n') pages = atoi(argv[++i]);
+    else if(a[1] == 'd') dirty = atoi(argv[++i]);
+    else if(a[1] == 'i') iters = atoi(argv[++i]);
+    else usage();
+  }
+  if(pages <= 0 || iters <= 0 || dirty < 0) usage();
+  if(dirty > pages) dirty = pages;
+
+  char *base = sbrk(pages * PGSZ);
+  char *copy = sbrk(pages * PGSZ);
+  if(base == (char*)-1 || copy == (char*)-1) fail("sbrk");
+  for(int p = 0; p < pages; p++){
+    base[p * PGSZ] = (char)(p & 0x7f);
+    copy[p * PGSZ] = 0;
+  }
+
+  printf(1, "[ckptbench] pid=%d pages=%d dirty=%d iters=%d\n", getpid(), pages, dirty, iters);
+
+  int tc = bench_checkpoint(iters);
+  int tf = bench_copy(copy, base, pages, iters);
+  int tr = bench_restore(base, pages, dirty, iters);
+
+  printf(1, "checkpoint+discard : %d ticks / %d\n", tc, iters);
+  printf(1, "full heap copy     : %d ticks / %d\n", tf, iters);
+  printf(1, "restore (%d dirty) : %d ticks / %d\n", dirty, tr, iters);
+  exit();
+}
@@ -0,0 +1,213 @@
+// compact.c — physical memory compaction
+//
+// Long uptime leaves free frames scattered over physical memory. compact()
+// moves in-use user frames from the bottom of memory into free frames near
+// the top, so free space coalesces into long runs at the bottom. A frame
+// is movable when every mapper the IPT reports belongs to a parked process
+// (p->parked), or to a checkpoint of one: one that is not running and was
+// stopped where it holds no physical address taken from its page table,
+// namely preempted in user mode, asleep in sleep() or wait(), or a fork
+// child yet to run. A process preempted or asleep anywhere else in the
+// kernel may be between reading a PTE and using the frame (copyuvm(),
+// copyout(), the checkpoint and COW paths), so its frames stay put.
+// Parked address spaces have no TLB entries on any CPU (switchkvm() and
+// switchuvm() reload %cr3), and holding ptable.lock keeps them from being
+// scheduled while their PTEs, IPT entries and STLB entries are rewritten;
+// the scheduler clears p->parked when it runs the process again.
+//
+// Frames of exec's new page table (not yet any process's pgdir), kernel
+// pages and frames of running or exiting processes are left in place.
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "memlayout.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "ipt.h"
+#include "softtlb.h"
+#include "mckpt.h"
+#include "pframe.h"
+#include "compact.h"
+
+extern struct {
+  struct spinlock lock;
+  struct proc proc[NPROC];
+} ptable;
+
+extern char end[]; // first address after kernel loaded from ELF file
+
+#define MAPWORDS ((COMPACT_NFRAME + 31) / 32)
+#define TESTBIT(m, i) ((m)[(i) / 32] & (1u << ((i) % 32)))
+#define SETBIT(m, i)  ((m)[(i) / 32] |= 1u << ((i) % 32))
+
+// Working state; one compaction at a time (compact_busy)
+static struct spinlock compact_lock;
+static int compact_busy;
+static uint freemap[MAPWORDS];  // free frames at planning time
+static uint want[MAPWORDS];     // planned targets
+static uint got[MAPWORDS];      // targets actually reserved
+static uint src[COMPACT_BATCH], dst[COMPACT_BATCH];
+
+// Initialize the compaction state.
+void
+compact_init(void)
+{
+  initlock(&compact_lock, "compact");
+  compact_busy = 0;
+}
+
+// longest run of free frames, and number of free aligned blocks
+static void
+free_runs(uint *map, uint *largest, uint *blocks)
+{
+  uint run = 0, best = 0, nblk = 0;
+
+  for(uint pfn = 0; pfn < COMPACT_NFRAME; pfn++){
+    if(TESTBIT(map, pfn)){
+      if(++run > best) best = run;
+      if(run >= COMPACT_BLOCK && (pfn + 1) % COMPACT_BLOCK == 0)
+        nblk++;
+    }else
+      run = 0;
+  }
+  *largest = best;
+  *blocks = nblk;
+}
+
+// Can pgdir's mappings be rewritten now? ptable.lock must be held.
+static int
+pgdir_movable(pde_t *pgdir)
+{
+  pde_t *owner = mckpt_owner(pgdir);  // checkpoints move with their owner
+  if(owner)
+    pgdir = owner;
+
+  for(struct proc *p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pgdir == pgdir)
+      return (p->state == SLEEPING || p->state == RUNNABLE) && p->parked;
+  return 0;  // exec in progress or being torn down
+}
+
+// Move the contents and every mapping of frame s to the free frame d.
+// Returns 0 on success, -1 if s cannot be moved right now.
+static int
+migrate(uint s, uint d)
+{
+  struct ipt_entry maps[COMPACT_MAXMAP];
+
+  acquire(&ptable.lock);
+  int n = ipt_list_for_pfn(s, maps, COMPACT_MAXMAP);
+  if(n == 0 || n == COMPACT_MAXMAP || maps[0].refcnt != n)
+    goto fail;  // not a user frame, or too many mappers to handle
+
+  // every mapper must be parked and still point at s
+  for(int i = 0; i < n; i++){
+    if(!pgdir_movable(maps[i].pgdir))
+      goto fail;
+    if(pte_retarget(maps[i].pgdir, maps[i].va, s << 12, s << 12) < 0)
+      goto fail;
+  }
+
+  memmove(P2V(d << 12), P2V(s << 12), PGSIZE);
+  for(int i = 0; i < n; i++){
+    pte_retarget(maps[i].pgdir, maps[i].va, s << 12, d << 12);
+    stlb_invalidate_one(maps[i].pgdir, maps[i].va);
+  }
+  ipt_move(s, d);
+
+  // the frame table follows the page
+  if(s < PFNNUM && d < PFNNUM){
+    acquire(&pf_lock);
+    pf_info[d].pid = pf_info[s].pid;
+    pf_info[d].start_tick = pf_info[s].start_tick;
+    release(&pf_lock);
+  }
+  release(&ptable.lock);
+  return 0;
+
+fail:
+  release(&ptable.lock);
+  return -1;
+}
+
+// plan up to COMPACT_BATCH moves: used frames from *lo upward into free
+// frames from *hi downward. Returns the number planned.
+static int
+plan(uint *lo, uint *hi)
+{
+  int n = 0;
+
+  memset(want, 0, sizeof(want));
+  memset(got, 0, sizeof(got));
+  while(n < COMPACT_BATCH){
+    while(*lo < *hi && (TESTBIT(freemap, *lo) || ipt_pfn_refs(*lo) == 0))
+      (*lo)++;  // free, or not a user frame
+    while(*hi > *lo && !TESTBIT(freemap, *hi))
+      (*hi)--;
+    if(*lo >= *hi)
+      break;
+    src[n] = *lo;
+    dst[n] = *hi;
+    SETBIT(want, *hi);
+    n++;
+    (*lo)++;
+    (*hi)--;
+  }
+  return n;
+}
+
+// Compact physical memory and fill in *st. Returns 0, or -1 if another
+// compaction is already running.
+int
+compact(struct compact_stats *st)
+{
+  acquire(&compact_lock);
+  if(compact_busy){
+    release(&compact_lock);
+    return -1;
+  }
+  compact_busy = 1;
+  release(&compact_lock);
+
+  memset(st, 0, sizeof(*st));
+  kfree_map(freemap, COMPACT_NFRAME);
+  free_runs(freemap, &st->largest_before, &st->blocks_before);
+
+  uint lo = V2P(end) >> 12, hi = COMPACT_NFRAME - 1;
+  for(;;){
+    int n = plan(&lo, &hi);
+    if(n == 0)
+      break;
+    kalloc_take(want, got, COMPACT_NFRAME);
+
+    // migrate, then hand back the vacated frames and unused targets at once
+    char *back = 0;
+    for(int i = 0; i < n; i++){
+      if(!TESTBIT(got, dst[i])){
+        st->skipped++;  // target allocated since planning
+        continue;
+      }
+      uint f = dst[i];
+      if(migrate(src[i], dst[i]) == 0){
+        st->moved++;
+        f = src[i];
+      }else
+        st->skipped++;
+      char *v = P2V(f << 12);
+      *(char**)v = back;  // chain for kfree_list
+      back = v;
+    }
+    kfree_list(back);
+  }
+  lcr3(V2P(myproc()->pgdir));  // flush this CPU's TLB
+
+  st->free_frames = kfree_map(freemap, COMPACT_NFRAME);
+  free_runs(freemap, &st->largest_after, &st->blocks_after);
+
+  acquire(&compact_lock);
+  compact_busy = 0;
+  release(&compact_lock);
+  return 0;
+}
@@ -0,0 +1,25 @@
+// Physical memory compaction (migrating user frames to rebuild free runs)
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "types.h"
+
+#define COMPACT_NFRAME (PHYSTOP >> 12)  // frames covered by the free-frame maps
+#define COMPACT_BATCH  256              // migrations planned per round
+#define COMPACT_BLOCK  1024             // aligned block size reported (4MB)
+#define COMPACT_MAXMAP 16               // mappers of one frame handled
+
+// Result of one compaction run
+struct compact_stats {
+  uint free_frames;     // Free frames after the run
+  uint largest_before;  // Longest run of free frames before
+  uint largest_after;   // Longest run of free frames after
+  uint blocks_before;   // Free COMPACT_BLOCK-aligned blocks before
+  uint blocks_after;    // Free COMPACT_BLOCK-aligned blocks after
+  uint moved;           // Frames migrated
+  uint skipped;         // Candidates left in place (busy or unmovable)
+};
+
+void compact_init(void);
+int  compact(struct compact_stats *st);
+#endif
@@ -0,0 +1,48 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+static void
+usage(void)
+{
+  printf(1, "usage: compactd [-i ticks]\n");
+  exit();
+}
+
+static void
+report(struct compact_stats *st)
+{
+  printf(1, "[compactd] moved=%d skipped=%d free=%d\n", st->moved, st->skipped, st->free_frames);
+  printf(1, "[compactd] largest free run: %d -> %d frames\n", st->largest_before, st->largest_after);
+  printf(1, "[compactd] free 4MB blocks:  %d -> %d\n", st->blocks_before, st->blocks_after);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct compact_stats st;
+  int interval = 0;  // 0: compact once and exit
+
+  if(argc == 3 && strcmp(argv[1], "-i") == 0)
+    interval = atoi(argv[2]);
+  else if(argc != 1)
+    usage();
+  if(interval < 0) usage();
+
+  if(interval == 0){
+    if(compact(&st) < 0){
+      printf(1, "[compactd] compaction already running\n");
+      exit();
+    }
+    report(&st);
+    exit();
+  }
+
+  // daemon: compact every interval ticks, report runs that moved frames
+  printf(1, "[compactd] pid=%d interval=%d\n", getpid(), interval);
+  for(;;){
+    if(compact(&st) == 0 && st.moved > 0)
+      report(&st);
+    sleep(interval);
+  }
+}
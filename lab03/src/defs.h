@@ -67,6 +67,9 @@ void            ioapicinit(void);
 // kalloc.c
 char*           kalloc(void);
 void            kfree(char*);
+void            kfree_list(char*);
+int             kfree_map(uint*, uint);
+int             kalloc_take(uint*, uint*, uint);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
 
@@ -108,6 +111,7 @@ int             cpuid(void);
 void            exit(void);
 int             fork(void);
 int             growproc(int);
+int             growstack(uint, int);
 int             kill(int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
@@ -188,6 +192,13 @@ int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
 pde_t*  		copyuvm_cow(pde_t *pgdir, uint sz);
 int 			cow_fault(pde_t *pgdir, uint va);
+int             cowshare_page(pde_t *pgdir, pde_t *snap, uint va);
+uint            pte_clear_ad(pde_t *pgdir, uint va);
+int             pte_retarget(pde_t *pgdir, uint va, uint from, uint to);
+int             zero_fault(pde_t *pgdir, uint sz, uint va, uint around);
+int             prefaultuvm(pde_t *pgdir, uint start, uint end);
+int             uvm_prepare(uint, uint, int);
+int             vtop_bench(pde_t *pgdir, uint *va, uint *pa, int n, int mode);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
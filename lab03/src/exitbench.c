@@ -0,0 +1,91 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+
+#define PGSZ 4096
+
+// time stamp counter in units of 1024 cycles (fits 32 bits for ~1 hour)
+static uint
+kcycles(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return (hi << 22) | (lo >> 10);
+}
+
+// grow by bytes and touch every page
+static char*
+grow(int bytes)
+{
+  char *p = sbrk(bytes);
+  if(p == (char*)-1) fail("sbrk");
+  for(int i = 0; i < bytes; i += PGSZ)
+    p[i] = 1;
+  return p;
+}
+
+// shrink the heap by bytes in one sbrk() call
+static uint
+bench_shrink(int bytes)
+{
+  grow(bytes);
+  uint t0 = kcycles();
+  if(sbrk(-bytes) == (char*)-1) fail("sbrk shrink");
+  return kcycles() - t0;
+}
+
+// a child with bytes of heap exits; time from "go" until wait() returns
+static uint
+bench_exit(int bytes)
+{
+  int ready[2], go[2];
+  char c = 0;
+
+  if(pipe(ready) < 0 || pipe(go) < 0) fail("pipe");
+  int pid = fork();
+  if(pid < 0) fail("fork");
+  if(pid == 0){
+    grow(bytes);
+    write(ready[1], &c, 1);
+    read(go[0], &c, 1);
+    exit();
+  }
+  if(read(ready[0], &c, 1) != 1) fail("child setup");
+
+  uint t0 = kcycles();
+  write(go[1], &c, 1);
+  wait();
+  uint t = kcycles() - t0;
+
+  close(ready[0]); close(ready[1]);
+  close(go[0]); close(go[1]);
+  return t;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int mb = 64;
+  int iters = 3;
+
+  benchinit("exitbench", "[-m megabytes] [-i iters]");
+  for(int i = 1; i < argc; i++){
+    char *a = argv[i];
+    if(a[0] != '-' || i + 1 >= argc) usage();
+    if(a[1] == 'm') mb = atoi(argv[++i]);
+    else if(a[1] == 'i') iters = atoi(argv[++i]);
+    else usage();
+  }
+  if(mb <= 0 || iters <= 0) usage();
+
+  int bytes = mb * 1024 * 1024;
+  printf(1, "[exitbench] %dMB (%d pages), %d iters, times in kcycles\n", mb, bytes / PGSZ, iters);
+  printf(1, "[iter]\t[shrink]\t[exit+wait]\n");
+  for(int i = 0; i < iters; i++){
+    uint ts = bench_shrink(bytes);
+    uint te = bench_exit(bytes);
+    printf(1, "%d\t%d\t%d\n", i, ts, te);
+  }
+  exit();
+}
@@ -0,0 +1,97 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+static char *names[FLT_NTYPE] = { "cow-copy", "cow-reuse", "zero", "fatal", "stack" };
+
+static void
+usage(void)
+{
+  printf(1, "usage: faultstat [-r] | faultstat -c cmd [args ...]\n");
+  exit();
+}
+
+// sum/count without 64-bit division: scale both down until sum fits
+static uint
+avg(uint lo, uint hi, uint count)
+{
+  while(hi != 0){
+    lo = (lo >> 1) | (hi << 31);
+    hi >>= 1;
+    count >>= 1;
+  }
+  return count ? lo / count : 0;
+}
+
+static void
+show(struct faultstat *st)
+{
+  printf(1, "[type]\t[count]\t[avg cycles]\n");
+  for(int t = 0; t < FLT_NTYPE; t++){
+    uint n = 0;
+    for(int c = 0; c < st->ncpu; c++)
+      n += st->count[c][t];
+    printf(1, "%s\t%d\t%d\n", names[t], n, avg(st->cycles_lo[t], st->cycles_hi[t], n));
+  }
+
+  printf(1, "\n[cpu]");
+  for(int t = 0; t < FLT_NTYPE; t++)
+    printf(1, "\t[%s]", names[t]);
+  printf(1, "\n");
+  for(int c = 0; c < st->ncpu; c++){
+    printf(1, "%d", c);
+    for(int t = 0; t < FLT_NTYPE; t++)
+      printf(1, "\t%d", st->count[c][t]);
+    printf(1, "\n");
+  }
+
+  // latency histograms, non-empty buckets only
+  for(int t = 0; t < FLT_NTYPE; t++){
+    int any = 0;
+    for(int b = 0; b < FLT_NBUCKET; b++){
+      if(st->hist[t][b] == 0) continue;
+      if(!any) printf(1, "\n%s latency (cycles):\n", names[t]);
+      any = 1;
+      printf(1, "  >= 2^%d\t%d\n", b, st->hist[t][b]);
+    }
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct faultstat st;
+
+  if(argc > 1 && strcmp(argv[1], "-c") == 0){
+    // run cmd with fresh counters, then report what it caused
+    if(argc < 3) usage();
+    faultstat(0, 1);
+    int pid = fork();
+    if(pid < 0){
+      printf(1, "faultstat: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[2], &argv[2]);
+      printf(1, "faultstat: exec %s failed\n", argv[2]);
+      exit();
+    }
+    wait();
+    if(faultstat(&st, 0) < 0) exit();
+    show(&st);
+    exit();
+  }
+
+  int reset = 0;
+  if(argc > 1){
+    if(strcmp(argv[1], "-r") != 0) usage();
+    reset = 1;
+  }
+  if(faultstat(&st, reset) < 0){
+    printf(1, "faultstat: system call failed\n");
+    exit();
+  }
+  show(&st);
+  if(reset) printf(1, "\n(counters reset)\n");
+  exit();
+}
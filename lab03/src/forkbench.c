@@ -0,0 +1,78 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+#include "forkpolicy.h"
+
+#define PGSZ 4096
+
+static int sizes[] = { 16, 256, 1024, 4096 };  // heap sizes (pages)
+#define NSIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+// time stamp counter in units of 1024 cycles
+static uint
+kcycles(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return (hi << 22) | (lo >> 10);
+}
+
+// iters x (fork, child writes touch% of heap pages and exits, wait)
+static uint
+bench(char *heap, int pages, int touch, int iters)
+{
+  int ntouch = pages * touch / 100;
+
+  uint t0 = kcycles();
+  for(int i = 0; i < iters; i++){
+    int pid = fork();
+    if(pid < 0) fail("fork");
+    if(pid == 0){
+      for(int p = 0; p < ntouch; p++)
+        heap[p * PGSZ] = (char)i;
+      exit();
+    }
+    wait();
+  }
+  return kcycles() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int iters = 20;
+  int touch = 100;  // % of heap pages each child writes
+
+  benchinit("forkbench", "[-i iters] [-t touch%]");
+  for(int i = 1; i < argc; i++){
+    char *a = argv[i];
+    if(a[0] != '-' || i + 1 >= argc) usage();
+    if(a[1] == 'i') iters = atoi(argv[++i]);
+    else if(a[1] == 't') touch = atoi(argv[++i]);
+    else usage();
+  }
+  if(iters <= 0 || touch < 0 || touch > 100) usage();
+
+  char *base = sbrk(0);
+  printf(1, "[forkbench] iters=%d touch=%d%%, kcycles per fork+touch+exit\n", iters, touch);
+  printf(1, "[pages]\t[cow]\t[eager]\t[adaptive]\t[wfrac]\n");
+  for(int s = 0; s < NSIZES; s++){
+    int pages = sizes[s];
+    char *cur = sbrk(0);
+    if(sbrk(base + pages * PGSZ - cur) == (char*)-1) fail("sbrk");
+    for(int p = 0; p < pages; p++)
+      base[p * PGSZ] = 1;
+
+    printf(1, "%d", pages);
+    for(int pol = FORK_COW; pol <= FORK_ADAPTIVE; pol++){
+      if(setforkpolicy(pol) < 0) fail("setforkpolicy");
+      printf(1, "\t%d", bench(base, pages, touch, iters) / iters);
+    }
+    struct procinfo info;
+    if(get_procinfo(0, &info) < 0) fail("get_procinfo");
+    printf(1, "\t\t%d%%\n", info.fork_wfrac);
+  }
+  setforkpolicy(FORK_COW);
+  exit();
+}
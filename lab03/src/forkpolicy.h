@@ -0,0 +1,9 @@
+// fork() copy policies (shared by kernel and user programs)
+#define FORK_COW      0  // default: share pages copy-on-write
+#define FORK_EAGER    1  // copy every page at fork
+#define FORK_ADAPTIVE 2  // eager for small parents or children that write most pages
+
+#define FORK_SMALL_PAGES 16 // adaptive: parents up to this size copy eagerly
+#define FORK_EAGER_PCT   50 // adaptive: copy eagerly once children write this % of pages
+#define FORK_EWMA_SHIFT  2  // weight 1/4 on each child's write fraction
+#define FORK_PROBE       8  // adaptive: every 8th fork uses COW to re-measure
@@ -6,10 +6,17 @@
 #include "proc.h"
 #include "defs.h"
 #include "ipt.h"
+#include "rss.h"
 
 static struct ipt_entry *ipt_buckets[IPT_HASH_SIZE];
 static struct spinlock   ipt_lock;
 
+#ifdef IPT_HASHED
+// Second chain through the same entries, keyed by (pgdir, vpg), so a
+// translation is one bucket probe instead of a page-table walk.
+static struct ipt_entry *ipt_vbuckets[IPT_HASH_SIZE];
+#endif
+
 // PFN-global reference counter: how many (pgdir,vpg) mappings refer to PFN.
 #define MAX_PFN   (PHYSTOP >> 12)
 static int ipt_pfn_refcnt[MAX_PFN];
@@ -27,6 +34,56 @@ valid_pfn(uint pfn)
   return pfn < MAX_PFN;
 }
 
+#ifdef IPT_HASHED
+// link e into the (pgdir, va) index; ipt_lock must be held
+static void
+ipt_vlink(struct ipt_entry *e)
+{
+  int h = IPT_VHASH(e->pgdir, e->va);
+  e->vnext = ipt_vbuckets[h];
+  ipt_vbuckets[h] = e;
+}
+
+// unlink e from the (pgdir, va) index; ipt_lock must be held
+static void
+ipt_vunlink(struct ipt_entry *e)
+{
+  struct ipt_entry **pp = &ipt_vbuckets[IPT_VHASH(e->pgdir, e->va)];
+  for(; *pp; pp = &(*pp)->vnext){
+    if(*pp == e){
+      *pp = e->vnext;
+      return;
+    }
+  }
+}
+#else
+#define ipt_vlink(e)
+#define ipt_vunlink(e)
+#endif
+
+// Keep the RSS shared-page counts in step with one mapping of pfn by pgdir
+// being added (new > old) or removed. self is the added entry, or 0.
+// ipt_lock must be held.
+static void
+ipt_account_shared(uint pfn, pde_t *pgdir, struct ipt_entry *self, int old, int new)
+{
+  if(new > old){
+    if(new >= 2) rss_add(pgdir, RSS_SHARED, 1);
+    if(new != 2) return;
+  }else{
+    if(old >= 2) rss_add(pgdir, RSS_SHARED, -1);
+    if(new != 1) return;
+  }
+
+  // the frame moved between one and two mappers: the other one changes too
+  for(struct ipt_entry *e = ipt_buckets[IPT_HASH(pfn)]; e; e = e->next){
+    if(e->pfn == pfn && e != self){
+      rss_add(e->pgdir, RSS_SHARED, (new > old) ? 1 : -1);
+      return;
+    }
+  }
+}
+
 int ipt_pfn_refs(uint pfn) {
   int n;
   acquire(&ipt_lock);
@@ -42,6 +99,10 @@ ipt_init(void)
   initlock(&ipt_lock, "ipt");
   for (int i = 0; i < IPT_HASH_SIZE; i++)
     ipt_buckets[i] = 0;
+#ifdef IPT_HASHED
+  for (int i = 0; i < IPT_HASH_SIZE; i++)
+    ipt_vbuckets[i] = 0;
+#endif
   for (int i = 0; i < MAX_PFN; i++)
     ipt_pfn_refcnt[i] = 0;
 }
@@ -77,9 +138,12 @@ ipt_insert(uint pfn, pde_t *pgdir, uint va, uint flags)
   e->refcnt = 1;     // per-entry ref = 1 (global refcnt is separate)
   e->next  = ipt_buckets[h];
   ipt_buckets[h] = e;
+  ipt_vlink(e);
 
-  if (valid_pfn(pfn))
+  if (valid_pfn(pfn)){
     ipt_pfn_refcnt[pfn]++;
+    ipt_account_shared(pfn, pgdir, e, ipt_pfn_refcnt[pfn] - 1, ipt_pfn_refcnt[pfn]);
+  }
 
   release(&ipt_lock);
   return 0;
@@ -100,6 +164,7 @@ ipt_remove(uint pfn, pde_t *pgdir, uint va)
     struct ipt_entry *e = *pp;
     if (e->pfn == pfn && e->pgdir == pgdir && e->va == vpg) {
       *pp = e->next;         // unlink
+      ipt_vunlink(e);
       kfree((char*)e);
       removed++;
       continue;              // keep scanning to remove duplicates if any
@@ -108,14 +173,50 @@ ipt_remove(uint pfn, pde_t *pgdir, uint va)
   }
 
   if (removed && valid_pfn(pfn)) {
-    ipt_pfn_refcnt[pfn] -= removed;
-    if (ipt_pfn_refcnt[pfn] < 0) ipt_pfn_refcnt[pfn] = 0; // safety
+    for (int i = 0; i < removed && ipt_pfn_refcnt[pfn] > 0; i++) {
+      ipt_pfn_refcnt[pfn]--;
+      ipt_account_shared(pfn, pgdir, 0, ipt_pfn_refcnt[pfn] + 1, ipt_pfn_refcnt[pfn]);
+    }
   }
 
   release(&ipt_lock);
   return removed; // useful for debugging
 }
 
+// Remove the mappings (pfn[i], pgdir, va[i]) for i < n under a single
+// lock hold and report how many mappers each frame has left in refs[i].
+// The entry pages are freed as one list afterwards.
+void
+ipt_remove_batch(pde_t *pgdir, uint *pfn, uint *va, int n, int *refs)
+{
+  char *junk = 0;
+
+  acquire(&ipt_lock);
+  for(int i = 0; i < n; i++){
+    uint vpg = vpage(va[i]);
+    struct ipt_entry **pp = &ipt_buckets[IPT_HASH(pfn[i])];
+    while(*pp){
+      struct ipt_entry *e = *pp;
+      if(e->pfn == pfn[i] && e->pgdir == pgdir && e->va == vpg){
+        *pp = e->next;         // unlink
+        ipt_vunlink(e);
+        *(char**)e = junk;     // chain for kfree_list
+        junk = (char*)e;
+        if(valid_pfn(pfn[i]) && ipt_pfn_refcnt[pfn[i]] > 0){
+          ipt_pfn_refcnt[pfn[i]]--;
+          ipt_account_shared(pfn[i], pgdir, 0, ipt_pfn_refcnt[pfn[i]] + 1, ipt_pfn_refcnt[pfn[i]]);
+        }
+        continue;              // keep scanning to remove duplicates if any
+      }
+      pp = &(*pp)->next;
+    }
+    refs[i] = valid_pfn(pfn[i]) ? ipt_pfn_refcnt[pfn[i]] : 0;
+  }
+  release(&ipt_lock);
+
+  kfree_list(junk);
+}
+
 // Remove all mappings owned by pgdir.
 void
 ipt_remove_all_of(pde_t *pgdir)
@@ -128,9 +229,12 @@ ipt_remove_all_of(pde_t *pgdir)
       if(e->pgdir == pgdir){
         uint pfn = e->pfn;
         *pp = e->next;
+        ipt_vunlink(e);
         kfree((char*)e);
-        if(valid_pfn(pfn) && ipt_pfn_refcnt[pfn] > 0)
+        if(valid_pfn(pfn) && ipt_pfn_refcnt[pfn] > 0){
           ipt_pfn_refcnt[pfn]--;
+          ipt_account_shared(pfn, pgdir, 0, ipt_pfn_refcnt[pfn] + 1, ipt_pfn_refcnt[pfn]);
+        }
       }else{
         pp = &(*pp)->next;
       }
@@ -139,6 +243,58 @@ ipt_remove_all_of(pde_t *pgdir)
   release(&ipt_lock);
 }
 
+// Move every mapping of frame src to frame dst (page migration). The
+// caller has already pointed the PTEs at dst; dst has no mappings.
+void
+ipt_move(uint src, uint dst)
+{
+  if(!valid_pfn(src) || !valid_pfn(dst))
+    return;
+
+  acquire(&ipt_lock);
+  struct ipt_entry **pp = &ipt_buckets[IPT_HASH(src)];
+  while(*pp){
+    struct ipt_entry *e = *pp;
+    if(e->pfn == src){
+      *pp = e->next;         // unlink, rehash under dst
+      e->pfn = dst;
+      e->next = ipt_buckets[IPT_HASH(dst)];
+      ipt_buckets[IPT_HASH(dst)] = e;
+      continue;
+    }
+    pp = &(*pp)->next;
+  }
+  ipt_pfn_refcnt[dst] = ipt_pfn_refcnt[src];
+  ipt_pfn_refcnt[src] = 0;
+  release(&ipt_lock);
+}
+
+// Translate (pgdir, va) through the IPT alone: one probe of the
+// (pgdir, va) index. Returns 0 and the page-aligned pa and flags, or -1
+// if va is not mapped (or the kernel was built without -DIPT_HASHED).
+int
+ipt_lookup_va(pde_t *pgdir, uint va, uint *pa, uint *flags)
+{
+#ifdef IPT_HASHED
+  uint vpg = vpage(va);
+  int r = -1;
+
+  acquire(&ipt_lock);
+  for(struct ipt_entry *e = ipt_vbuckets[IPT_VHASH(pgdir, vpg)]; e; e = e->vnext){
+    if(e->pgdir == pgdir && e->va == vpg){
+      if(pa) *pa = e->pfn << 12;
+      if(flags) *flags = e->flags;
+      r = 0;
+      break;
+    }
+  }
+  release(&ipt_lock);
+  return r;
+#else
+  return -1;
+#endif
+}
+
 // List mappings for a PFN into kernel buffer` kbuf (array of ipt_entry).
 int
 ipt_list_for_pfn(uint pfn, struct ipt_entry *kbuf, int max)
@@ -165,4 +321,21 @@ ipt_list_for_pfn(uint pfn, struct ipt_entry *kbuf, int max)
 
   release(&ipt_lock);
   return n; // number of entries written
-}
\ No newline at end of file
+}
+
+// Call fn on every mapping in hash buckets [h, h+n) while holding
+// ipt_lock, so a long walk can be split into slices.
+// fn must not call back into the IPT.
+// Returns the bucket to resume at, IPT_HASH_SIZE after the last one.
+int
+ipt_for_buckets(int h, int n, void (*fn)(struct ipt_entry *e))
+{
+  int end = (h + n < IPT_HASH_SIZE) ? h + n : IPT_HASH_SIZE;
+
+  acquire(&ipt_lock);
+  for(; h < end; h++)
+    for(struct ipt_entry *e = ipt_buckets[h]; e; e = e->next)
+      fn(e);
+  release(&ipt_lock);
+  return end;
+}
@@ -7,6 +7,13 @@
 #define IPT_HASH_SIZE 4096
 #define IPT_HASH(pfn) ((pfn) & (IPT_HASH_SIZE - 1))
 
+// (pgdir, va) index over the same entries, built with -DIPT_HASHED
+#define IPT_VHASH(pgdir, vpg) ((((uint)(pgdir) >> 12) ^ ((vpg) >> 12)) & (IPT_HASH_SIZE - 1))
+
+// vtop_bench() translation modes
+#define VTOP_WALK 0             // two-level page-table walk
+#define VTOP_HASH 1             // IPT (pgdir, va) hash probe
+
 // Inverse page table entry
 struct ipt_entry {
   uint pfn;               // Physical frame number
@@ -15,6 +22,9 @@ struct ipt_entry {
   uint flags;             // Flags (e.g., valid, dirty)
   int refcnt;             // Reference count
   struct ipt_entry *next; // Next entry in the hash bucket
+#ifdef IPT_HASHED
+  struct ipt_entry *vnext; // Next entry in the (pgdir, va) bucket
+#endif
 };
 
 // Functions to manage the inverse page table
@@ -23,5 +33,9 @@ int ipt_insert(uint pfn, pde_t *pgdir, uint va, uint flags);
 int ipt_remove(uint pfn, pde_t *pgdir, uint va);
 int ipt_list_for_pfn(uint pfn, struct ipt_entry *kbuf, int max);
 void ipt_remove_all_of(pde_t *pgdir);
+void ipt_remove_batch(pde_t *pgdir, uint *pfn, uint *va, int n, int *refs);
+void ipt_move(uint src, uint dst);
 int ipt_pfn_refs(uint pfn);
+int ipt_lookup_va(pde_t *pgdir, uint va, uint *pa, uint *flags);
+int ipt_for_buckets(int h, int n, void (*fn)(struct ipt_entry *e));
 #endif
\ No newline at end of file
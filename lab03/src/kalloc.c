@@ -10,6 +10,7 @@
 #include "spinlock.h"
 
 #include "pframe.h"
+#include "pfevent.h"
 #include "proc.h"
 
 // For physical frame tracking
@@ -96,6 +97,8 @@ kfree(char *v)
   // Update physical frame info if locking is enabled
   uint pa = V2P((uint)v);
   uint pfn = pa2pfn(pa);
+  if(kmem.use_lock)
+    pfev_record(pfn, pfn < PFNNUM ? pf_info[pfn].pid : -1, PFEV_FREE); // Log the free
   if(pfn < PFNNUM){
     if(kmem.use_lock) acquire(&pf_lock);
     pf_info[pfn].allocated = 0; // Mark frame as free
@@ -113,6 +116,100 @@ kfree(char *v)
   if(kmem.use_lock) release(&kmem.lock);
 }
 
+// Free a list of pages chained through their first word (a struct run
+// list) with one acquisition of the allocator locks, for bulk teardown.
+void
+kfree_list(char *head)
+{
+  struct run *r, *next, *tail = 0;
+
+  // junk-fill outside the lock, keeping the chain intact
+  for(r = (struct run*)head; r; r = next){
+    if((uint)r % PGSIZE || (char*)r < end || V2P(r) >= PHYSTOP)
+      panic("kfree_list");
+    next = r->next;
+    memset(r, 1, PGSIZE);
+    r->next = next;
+    tail = r;
+  }
+  if(tail == 0)
+    return;
+
+  if(kmem.use_lock) acquire(&kmem.lock);
+  if(kmem.use_lock) acquire(&pf_lock);
+  for(r = (struct run*)head; r; r = r->next){
+    uint pfn = pa2pfn(V2P((char*)r));
+    if(kmem.use_lock)
+      pfev_record(pfn, pfn < PFNNUM ? pf_info[pfn].pid : -1, PFEV_FREE); // Log the free
+    if(pfn < PFNNUM){
+      pf_info[pfn].allocated = 0;
+      pf_info[pfn].pid = -1;
+      pf_info[pfn].start_tick = 0;
+    }
+  }
+  if(kmem.use_lock) release(&pf_lock);
+
+  // splice the whole list onto the free list
+  tail->next = kmem.freelist;
+  kmem.freelist = (struct run*)head;
+  if(kmem.use_lock) release(&kmem.lock);
+}
+
+// Set the bit of every free frame in map (one bit per pfn, nframes bits).
+// Returns the number of free frames.
+int
+kfree_map(uint *map, uint nframes)
+{
+  struct run *r;
+  int n = 0;
+
+  memset(map, 0, (nframes + 31) / 32 * sizeof(uint));
+  if(kmem.use_lock) acquire(&kmem.lock);
+  for(r = kmem.freelist; r; r = r->next){
+    uint pfn = pa2pfn(V2P((char*)r));
+    if(pfn < nframes)
+      map[pfn / 32] |= 1u << (pfn % 32);
+    n++;
+  }
+  if(kmem.use_lock) release(&kmem.lock);
+  return n;
+}
+
+// Take the free frames whose bit is set in want off the free list and set
+// their bit in got (reserving migration targets for compaction).
+// Returns the number of frames taken.
+int
+kalloc_take(uint *want, uint *got, uint nframes)
+{
+  struct run **pp;
+  int n = 0;
+
+  if(kmem.use_lock) acquire(&kmem.lock);
+  pp = &kmem.freelist;
+  while(*pp){
+    struct run *r = *pp;
+    uint pfn = pa2pfn(V2P((char*)r));
+    if(pfn < nframes && (want[pfn / 32] & (1u << (pfn % 32)))){
+      *pp = r->next;
+      got[pfn / 32] |= 1u << (pfn % 32);
+      if(kmem.use_lock)
+        pfev_record(pfn, -1, PFEV_ALLOC); // Log the allocation
+      if(pfn < PFNNUM){
+        if(kmem.use_lock) acquire(&pf_lock);
+        pf_info[pfn].allocated = 1;
+        pf_info[pfn].pid = -1;          // owner set when a page moves in
+        pf_info[pfn].start_tick = ticks;
+        if(kmem.use_lock) release(&pf_lock);
+      }
+      n++;
+      continue;
+    }
+    pp = &r->next;
+  }
+  if(kmem.use_lock) release(&kmem.lock);
+  return n;
+}
+
 // Allocate one 4096-byte page of physical memory.
 // Returns a pointer that the kernel can use.
 // Returns 0 if the memory cannot be allocated.
@@ -130,6 +227,9 @@ kalloc(void)
     // Update physical frame info if locking is enabled
     if(kmem.use_lock) {
       struct proc *p = myproc();
+
+      // Log the allocation
+      pfev_record(pa2pfn(V2P((char*)r)), p ? p->pid : -1, PFEV_ALLOC);
       
       // Update physical frame info if a process is allocating
       if(p){
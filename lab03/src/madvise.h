@@ -0,0 +1,7 @@
+// madvise() advice values (shared by kernel and user programs)
+#define MADV_NORMAL     0  // default: no fault-around
+#define MADV_SEQUENTIAL 2  // map MADV_SEQ_PAGES extra pages per zero-fill fault
+#define MADV_WILLNEED   3  // prefault the range now
+#define MADV_DONTNEED   4  // free the frames; the range reads back as zeros
+
+#define MADV_SEQ_PAGES  15 // fault-around window for MADV_SEQUENTIAL
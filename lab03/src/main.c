@@ -7,6 +7,10 @@
 #include "x86.h"
 #include "ipt.h"
 #include "softtlb.h"
+#include "mckpt.h"
+#include "rss.h"
+#include "oom.h"
+#include "compact.h"
 
 static void startothers(void);
 static void mpmain(void)  __attribute__((noreturn));
@@ -37,6 +41,10 @@ main(void)
   kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
   ipt_init();    // initialize inverted page table
   stlb_init();   // initialize software TLB
+  mckpt_init();  // initialize address-space checkpoints
+  rss_init();    // initialize per-address-space frame accounting
+  oom_init();    // initialize the OOM kill log
+  compact_init(); // initialize physical memory compaction
   userinit();      // first user process
   mpmain();        // finish this processor's setup
 }
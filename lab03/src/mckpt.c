@@ -0,0 +1,255 @@
+// mckpt.c — address-space checkpoint/restore on top of COW + IPT refcounts
+//
+// A checkpoint is a second page directory built by copyuvm_cow(): the owner's
+// pages are write-protected and shared with the checkpoint, so taking one
+// costs a page-table walk, not a copy of the heap. The IPT refcount of every
+// shared frame includes the checkpoint's mapping, which makes the first write
+// after a checkpoint a COW copy. cow_fault() reports those pages here, so a
+// restore only has to touch the pages that actually diverged.
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "memlayout.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "mckpt.h"
+
+static struct mckpt mckpts[NMCKPT];
+static struct spinlock mckpt_lock;
+static int mckpt_nextid = 1;
+static volatile int mckpt_live = 0; // fast path for the fault/unmap hooks
+
+// Initialize the checkpoint table.
+void
+mckpt_init(void)
+{
+  initlock(&mckpt_lock, "mckpt");
+  for(int i = 0; i < NMCKPT; i++)
+    mckpts[i].id = 0;
+  mckpt_live = 0;
+}
+
+// find a live checkpoint of owner by id; mckpt_lock must be held
+static struct mckpt*
+mckpt_find(pde_t *owner, int id)
+{
+  for(int i = 0; i < NMCKPT; i++)
+    if(mckpts[i].id == id && mckpts[i].owner == owner)
+      return &mckpts[i];
+  return 0;
+}
+
+// Take a checkpoint of p's address space. Returns the checkpoint id (> 0)
+// or -1 if the table is full or memory is exhausted.
+int
+mckpt_create(struct proc *p)
+{
+  struct mckpt *ck = 0;
+
+  // reserve a slot
+  acquire(&mckpt_lock);
+  for(int i = 0; i < NMCKPT; i++){
+    if(mckpts[i].id == 0){
+      ck = &mckpts[i];
+      break;
+    }
+  }
+  if(ck == 0){
+    release(&mckpt_lock);
+    return -1;
+  }
+  ck->id = -1;        // reserved, not yet visible to the hooks
+  ck->owner = 0;
+  release(&mckpt_lock);
+
+  // dirty-page list (one page)
+  uint *dirty = (uint*)kalloc();
+  if(dirty == 0)
+    goto bad;
+
+  // share every page with the checkpoint and write-protect the owner
+  pde_t *snap = copyuvm_cow(p->pgdir, p->sz);
+  if(snap == 0){
+    kfree((char*)dirty);
+    goto bad;
+  }
+
+  acquire(&mckpt_lock);
+  ck->owner    = p->pgdir;
+  ck->pgdir    = snap;
+  ck->sz       = p->sz;
+  ck->lowsz    = p->sz;
+  ck->tf       = *p->tf;
+  ck->dirty    = dirty;
+  ck->ndirty   = 0;
+  ck->overflow = 0;
+  ck->id       = mckpt_nextid++;
+  mckpt_live++;
+  int id = ck->id;
+  release(&mckpt_lock);
+  return id;
+
+bad:
+  acquire(&mckpt_lock);
+  ck->id = 0;
+  release(&mckpt_lock);
+  return -1;
+}
+
+// Swap p's address space back to checkpoint id. Only pages that were
+// COW-copied since the checkpoint (and pages above the lowest size the
+// process shrank to) are touched. User registers are restored as well, so
+// the process resumes at its mcheckpoint() call, which then returns 0.
+int
+mckpt_restore(struct proc *p, int id)
+{
+  acquire(&mckpt_lock);
+  struct mckpt *ck = mckpt_find(p->pgdir, id);
+  release(&mckpt_lock);
+  if(ck == 0)
+    return -1;
+
+  // the owner is the only one modifying its own checkpoint, and it is here
+  uint low = ck->lowsz;
+  if(low > p->sz) low = p->sz;
+  if(low > ck->sz) low = ck->sz;
+
+  // anything above low is not the checkpoint's: drop it, then share back
+  deallocuvm(p->pgdir, p->sz, low);
+  for(uint va = PGROUNDUP(low); va < ck->sz; va += PGSIZE)
+    if(cowshare_page(p->pgdir, ck->pgdir, va) < 0)
+      return -1;
+
+  // below low, only pages that took a COW copy can differ
+  if(ck->overflow){
+    for(uint va = 0; va < PGROUNDUP(low); va += PGSIZE)
+      if(cowshare_page(p->pgdir, ck->pgdir, va) < 0)
+        return -1;
+  }else{
+    for(int i = 0; i < ck->ndirty; i++)
+      if(ck->dirty[i] < low && cowshare_page(p->pgdir, ck->pgdir, ck->dirty[i]) < 0)
+        return -1;
+  }
+  lcr3(V2P(p->pgdir)); // flush hardware TLB
+
+  acquire(&mckpt_lock);
+  ck->ndirty   = 0;
+  ck->overflow = 0;
+  ck->lowsz    = ck->sz;
+  release(&mckpt_lock);
+
+  p->sz = ck->sz;
+  *p->tf = ck->tf;
+  return 0;
+}
+
+// release a checkpoint slot (taken off the table by the caller)
+static void
+mckpt_free(pde_t *snap, uint *dirty)
+{
+  freevm(snap);
+  kfree((char*)dirty);
+}
+
+// Discard checkpoint id of p. Frames only the checkpoint still maps are
+// returned to the allocator.
+int
+mckpt_discard(struct proc *p, int id)
+{
+  acquire(&mckpt_lock);
+  struct mckpt *ck = mckpt_find(p->pgdir, id);
+  if(ck == 0){
+    release(&mckpt_lock);
+    return -1;
+  }
+  pde_t *snap = ck->pgdir;
+  uint *dirty = ck->dirty;
+  ck->id = 0;
+  mckpt_live--;
+  release(&mckpt_lock);
+
+  mckpt_free(snap, dirty);
+  return 0;
+}
+
+// Drop every checkpoint of an address space (called from freevm).
+void
+mckpt_drop_all(pde_t *owner)
+{
+  if(mckpt_live == 0)
+    return;
+
+  for(int i = 0; i < NMCKPT; i++){
+    acquire(&mckpt_lock);
+    if(mckpts[i].id <= 0 || mckpts[i].owner != owner){
+      release(&mckpt_lock);
+      continue;
+    }
+    pde_t *snap = mckpts[i].pgdir;
+    uint *dirty = mckpts[i].dirty;
+    mckpts[i].id = 0;
+    mckpt_live--;
+    release(&mckpt_lock);
+
+    mckpt_free(snap, dirty);
+  }
+}
+
+// Record that owner's page at va took a COW copy (called from cow_fault).
+void
+mckpt_note_write(pde_t *owner, uint va)
+{
+  if(mckpt_live == 0)
+    return;
+
+  acquire(&mckpt_lock);
+  for(int i = 0; i < NMCKPT; i++){
+    struct mckpt *ck = &mckpts[i];
+    if(ck->id <= 0 || ck->owner != owner || ck->overflow)
+      continue;
+    if(ck->ndirty < MCKPT_MAXDIRTY)
+      ck->dirty[ck->ndirty++] = PGROUNDDOWN(va);
+    else
+      ck->overflow = 1;
+  }
+  release(&mckpt_lock);
+}
+
+// Record that owner's size dropped to newsz (called from deallocuvm).
+void
+mckpt_note_shrink(pde_t *owner, uint newsz)
+{
+  if(mckpt_live == 0)
+    return;
+
+  acquire(&mckpt_lock);
+  for(int i = 0; i < NMCKPT; i++){
+    struct mckpt *ck = &mckpts[i];
+    if(ck->id > 0 && ck->owner == owner && newsz < ck->lowsz)
+      ck->lowsz = newsz;
+  }
+  release(&mckpt_lock);
+}
+
+// Return the address space snap is a checkpoint of, or 0 if snap is not
+// a checkpoint.
+pde_t*
+mckpt_owner(pde_t *snap)
+{
+  pde_t *owner = 0;
+
+  if(mckpt_live == 0)
+    return 0;
+
+  acquire(&mckpt_lock);
+  for(int i = 0; i < NMCKPT; i++){
+    if(mckpts[i].id > 0 && mckpts[i].pgdir == snap){
+      owner = mckpts[i].owner;
+      break;
+    }
+  }
+  release(&mckpt_lock);
+  return owner;
+}
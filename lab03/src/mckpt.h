@@ -0,0 +1,34 @@
+// Process address-space checkpoints (COW-shared snapshots of user memory)
+#ifndef MCKPT_H
+#define MCKPT_H
+
+#include "types.h"
+
+#define NMCKPT 16                           // max live checkpoints system-wide
+#define MCKPT_MAXDIRTY (4096 / sizeof(uint)) // dirty-page slots (one page)
+
+struct proc;
+
+// Checkpoint entry
+struct mckpt {
+  int id;                 // Checkpoint ID (0 if slot is free)
+  pde_t *owner;           // Address space the checkpoint was taken from
+  pde_t *pgdir;           // COW-shared copy of the owner's user mappings
+  uint sz;                // Owner's size at checkpoint time
+  uint lowsz;             // Lowest owner size seen since checkpoint/restore
+  struct trapframe tf;    // User registers at checkpoint time
+  uint *dirty;            // Pages COW-copied since checkpoint/restore
+  int ndirty;             // Number of valid entries in dirty[]
+  int overflow;           // dirty[] overflowed: restore scans whole range
+};
+
+// Functions to manage address-space checkpoints
+void mckpt_init(void);
+int  mckpt_create(struct proc *p);
+int  mckpt_restore(struct proc *p, int id);
+int  mckpt_discard(struct proc *p, int id);
+void mckpt_drop_all(pde_t *owner);
+void mckpt_note_write(pde_t *owner, uint va);
+void mckpt_note_shrink(pde_t *owner, uint newsz);
+pde_t* mckpt_owner(pde_t *snap);
+#endif
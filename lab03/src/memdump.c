@@ -4,21 +4,94 @@
 #include "fcntl.h"
 
 #define MAX_FRINFO 60000 
+#define NPID_MAX 128      // -s: 요약할 최대 pid 수
 
 static void
 usage(void)
 {
-    printf(1, "usage: memdump [-a] [-p PID]\n");
+    printf(1, "usage: memdump [-a] [-s] [-p PID] [-f TICKS]\n");
     exit();
 }
 
+// -f: 전체 테이블 대신 변경 이벤트만 TICKS 동안 스트리밍
+static void
+follow(int pid_filter, int duration)
+{
+    static struct pfevent ev[128];
+    static struct pfev_cursor cur;
+    uint lost = 0;
+
+    // 현재 시점부터 읽기 시작
+    physmem_events(ev, 0, &cur);
+
+    printf(1, "[memdump] pid=%d follow=%d ticks\n", getpid(), duration);
+    printf(1, "[seq]\t[event]\t[frame#]\t[pid]\t[tick]\n");
+
+    int t0 = uptime();
+    while(uptime() - t0 < duration){
+        int n = physmem_events(ev, 128, &cur);
+        if(n < 0){
+            printf(1, "memdump: physmem_events failed\n");
+            return;
+        }
+        if(cur.lost != lost){
+            printf(1, "[memdump] lost %d events (overflow)\n", cur.lost - lost);
+            lost = cur.lost;
+        }
+        for(int i = 0; i < n; i++){
+            if(pid_filter >= 0 && ev[i].pid != pid_filter) continue;
+            printf(1, "%d\t%s\t%d\t%d\t%d\n", ev[i].seq,
+                   ev[i].event == PFEV_ALLOC ? "alloc" : "free", ev[i].pfn, ev[i].pid, ev[i].tick);
+        }
+        if(n < 128) sleep(1);
+    }
+}
+
+// -s: 프로세스별 프레임 사용량 요약 (스택 페이지 포함)
+static void
+summary(struct physframe_info *buf, int n, int pid_filter)
+{
+    static int pids[NPID_MAX], owned[NPID_MAX];
+    int npid = 0;
+
+    // 프레임 테이블에 나타나는 pid별로 프레임 수 집계
+    for(int i = 0; i < n; i++){
+        int pid = buf[i].pid, k;
+        if(!buf[i].allocated || pid <= 0) continue;
+        if(pid_filter >= 0 && pid != pid_filter) continue;
+        for(k = 0; k < npid && pids[k] != pid; k++)
+            ;
+        if(k == npid){
+            if(npid == NPID_MAX) continue;
+            pids[npid] = pid;
+            owned[npid++] = 0;
+        }
+        owned[k]++;
+    }
+
+    printf(1, "[memdump] pid=%d summary\n", getpid());
+    printf(1, "[pid]\t[name]\t[frames]\t[rss]\t[stack]\t[limit]\n");
+    for(int k = 0; k < npid; k++){
+        struct procinfo info;
+        if(get_procinfo(pids[k], &info) < 0){
+            // 이미 종료된 프로세스
+            printf(1, "%d\t-\t%d\t-\t-\t-\n", pids[k], owned[k]);
+            continue;
+        }
+        printf(1, "%d\t%s\t%d\t%d\t%d\t%d\n", pids[k], info.name, owned[k],
+               info.rss_pages, info.stack_pages, info.stack_limit);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     if (argc == 1) usage();
 
     // 옵션 변수 초기화
     int show_all = 0;
+    int show_summary = 0;
     int pid_filter = -1;
+    int follow_ticks = 0;
     int i;
     
     // 옵션 처리
@@ -28,15 +101,25 @@ int main(int argc, char *argv[])
             if(a[0] != '-') usage();
             if(a[1] == 'a'){
                 show_all = 1;
+            }else if(a[1] == 's'){
+                show_summary = 1;
             }else if(a[1] == 'p'){
                 if(i + 1 >= argc) usage();
                 pid_filter = atoi(argv[++i]);
+            }else if(a[1] == 'f'){
+                if(i + 1 >= argc) usage();
+                follow_ticks = atoi(argv[++i]);
             }else {
                 usage();
             }
         }
     }
 
+    if(follow_ticks > 0){
+        follow(pid_filter, follow_ticks);
+        exit();
+    }
+
     static struct physframe_info buf[MAX_FRINFO];
     int n = dump_physmem_info((void *)buf, MAX_FRINFO);
     if (n < 0)
@@ -45,6 +128,11 @@ int main(int argc, char *argv[])
         exit();
     }
 
+    if(show_summary){
+        summary(buf, n, pid_filter);
+        exit();
+    }
+
     printf(1, "[memdump] pid=%d\n", getpid());
     printf(1, "[frame#]\t[alloc]\t[pid]\t[start_tick]\n");
 
@@ -0,0 +1,167 @@
+// oom.c — out-of-memory killer
+//
+// When a user allocation finds the free list empty, oom_kalloc() ranks the
+// live processes by the frames their address space holds (the incremental
+// rss counters, which follow every IPT insert/remove) plus an adjustable
+// per-process score, kills the worst one and sleeps until its frames are
+// back. exit() of an OOM victim frees its address space right away instead
+// of leaving it to the parent's wait(), so the retry does not depend on the
+// parent getting scheduled. Kills are logged to a small ring that user
+// space reads with oom_events().
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "memlayout.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "rss.h"
+#include "oom.h"
+
+#define OOM_SCALE (PHYSTOP / PGSIZE) // score of oom_adj 1000 (all of memory)
+
+extern struct {
+  struct spinlock lock;
+  struct proc proc[NPROC];
+} ptable;
+
+static struct spinlock oom_lock;
+static struct oom_event oom_log[OOM_NLOG];
+static uint oom_nevents;
+
+// Initialize the kill log.
+void
+oom_init(void)
+{
+  initlock(&oom_lock, "oom");
+  oom_nevents = 0;
+}
+
+// badness of p: frames it would give back, biased by oom_adj
+static int
+oom_badness(struct proc *p, int *frames)
+{
+  int cnt[RSS_NFIELD] = { 0 };
+
+  if(p->pgdir) rss_get(p->pgdir, cnt);
+  *frames = cnt[RSS_RESIDENT] + cnt[RSS_PTPAGES];
+  return *frames + p->oom_adj * OOM_SCALE / 1000;
+}
+
+// pick the victim; ptable.lock must be held. A victim killed earlier that
+// has not exited yet is returned again so the caller waits for it instead
+// of killing a second process.
+static struct proc*
+oom_select(int *frames, int *score)
+{
+  struct proc *p, *best = 0;
+  int f, s;
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state != SLEEPING && p->state != RUNNABLE && p->state != RUNNING)
+      continue;
+    if(p->pid == 1 || p->oom_adj <= OOM_ADJ_MIN)
+      continue;
+    s = oom_badness(p, &f);
+    if(p->oom_killed){
+      *frames = f;
+      *score = s;
+      return p;
+    }
+    if(best == 0 || s > *score){
+      best = p;
+      *frames = f;
+      *score = s;
+    }
+  }
+  return best;
+}
+
+// append a kill to the log; ptable.lock is held (oom_lock is a leaf)
+static void
+oom_record(struct proc *victim, int frames, int score, int trigger)
+{
+  acquire(&oom_lock);
+  struct oom_event *e = &oom_log[oom_nevents % OOM_NLOG];
+  e->seq = ++oom_nevents;
+  e->tick = ticks;
+  e->pid = victim->pid;
+  safestrcpy(e->name, victim->name, sizeof(e->name));
+  e->frames = frames;
+  e->score = score;
+  e->trigger = trigger;
+  release(&oom_lock);
+}
+
+// The caller may sleep only in process context with no spinlock held
+// (a page fault taken inside e.g. piperead holds the pipe lock).
+static int
+oom_can_sleep(void)
+{
+  pushcli();
+  int n = mycpu()->ncli;
+  popcli();
+  return myproc() != 0 && n == 1;
+}
+
+// Kill the worst process and wait until its frames are freed.
+// Returns -1 if there is nothing to kill but the caller itself.
+static int
+oom_kill_one(void)
+{
+  struct proc *cur = myproc();
+  int frames = 0, score = 0;
+
+  acquire(&ptable.lock);
+  struct proc *victim = oom_select(&frames, &score);
+  if(victim == 0 || victim == cur){
+    release(&ptable.lock);
+    return -1;
+  }
+  if(!victim->oom_killed){
+    victim->oom_killed = 1;
+    victim->killed = 1;
+    if(victim->state == SLEEPING)
+      victim->state = RUNNABLE;
+    oom_record(victim, frames, score, cur->pid);
+  }
+
+  // exit() frees the victim's address space before it turns ZOMBIE
+  int pid = victim->pid;
+  uint t0 = ticks;
+  while(victim->pid == pid && victim->state != ZOMBIE && victim->state != UNUSED &&
+        ticks - t0 < OOM_WAIT_TICKS && !cur->killed)
+    sleep(&ticks, &ptable.lock);
+  release(&ptable.lock);
+  return 0;
+}
+
+// kalloc() for user pages: on failure, kill processes to make room and
+// retry. Returns 0 if memory could not be found.
+char*
+oom_kalloc(void)
+{
+  char *mem = kalloc();
+
+  for(int i = 0; mem == 0 && i < OOM_RETRIES; i++){
+    if(!oom_can_sleep() || oom_kill_one() < 0)
+      break;
+    mem = kalloc();
+  }
+  return mem;
+}
+
+// Copy up to max of the most recent kill events into out, oldest first.
+// Returns the number copied.
+int
+oom_read(struct oom_event *out, int max)
+{
+  acquire(&oom_lock);
+  uint n = oom_nevents < OOM_NLOG ? oom_nevents : OOM_NLOG;
+  if(max < n) n = max;
+  for(uint i = 0; i < n; i++)
+    out[i] = oom_log[(oom_nevents - n + i) % OOM_NLOG];
+  release(&oom_lock);
+  return n;
+}
@@ -0,0 +1,27 @@
+// Out-of-memory killer (victim selection from per-address-space frame counts)
+#ifndef OOM_H
+#define OOM_H
+
+#include "types.h"
+
+#define OOM_NLOG        32     // kill events kept (power of two)
+#define OOM_RETRIES     4      // kills attempted per failed allocation
+#define OOM_WAIT_TICKS  100    // max wait for a victim's frames
+#define OOM_ADJ_MIN     (-1000) // never selected
+#define OOM_ADJ_MAX     1000    // always selected first
+
+// Kill event record
+struct oom_event {
+  uint seq;       // Event number (1, 2, ...)
+  uint tick;      // Tick of the kill
+  int pid;        // Victim
+  char name[16];  // Victim name
+  int frames;     // Victim resident + page-table frames at kill time
+  int score;      // Badness score the victim was ranked by
+  int trigger;    // Process whose allocation failed
+};
+
+void  oom_init(void);
+char* oom_kalloc(void);
+int   oom_read(struct oom_event *out, int max);
+#endif
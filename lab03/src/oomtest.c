@@ -0,0 +1,88 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PGSZ 4096
+#define CHUNK (64 * PGSZ)  // sbrk step of the grower
+
+// touch every page so the frames are really resident
+static void
+touch(char *p, int n)
+{
+  for(int i = 0; i < n; i += PGSZ)
+    p[i] = 1;
+}
+
+// preferred victim: hold `pages` pages until killed
+static void
+victim(int pages)
+{
+  oom_adjust(0, 1000);
+  char *p = sbrk(pages * PGSZ);
+  if(p == (char*)-1){
+    printf(1, "[oomtest] victim: sbrk failed\n");
+    exit();
+  }
+  touch(p, pages * PGSZ);
+  for(;;)
+    sleep(100);
+}
+
+// grow until sbrk fails; the kernel kills the victim first, and fails the
+// grower's allocation once it is the only candidate left
+static void
+grower(void)
+{
+  int total = 0;
+
+  oom_adjust(0, 0);
+  for(;;){
+    char *p = sbrk(CHUNK);
+    if(p == (char*)-1)
+      break;
+    touch(p, CHUNK);
+    total += CHUNK / PGSZ;
+  }
+  printf(1, "[oomtest] grower: sbrk failed after %d pages\n", total);
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pages = 1024;  // victim size (4MB)
+  struct oom_event ev[8];
+
+  if(argc > 1) pages = atoi(argv[1]);
+  if(pages <= 0){
+    printf(1, "usage: oomtest [victim_pages]\n");
+    exit();
+  }
+
+  // protect this process; children set their own score
+  oom_adjust(0, -1000);
+  int before = oom_events(ev, 8);
+  uint lastseq = before > 0 ? ev[before - 1].seq : 0;
+
+  int vpid = fork();
+  if(vpid == 0) victim(pages);
+  sleep(50);  // let the victim fault its pages in
+
+  int gpid = fork();
+  if(gpid == 0) grower();
+
+  wait();
+  wait();
+
+  int n = oom_events(ev, 8);
+  int found = 0;
+  printf(1, "[seq]\t[tick]\t[pid]\t[name]\t[frames]\t[score]\t[trigger]\n");
+  for(int i = 0; i < n; i++){
+    if(ev[i].seq <= lastseq) continue;
+    printf(1, "%d\t%d\t%d\t%s\t%d\t%d\t%d\n", ev[i].seq, ev[i].tick, ev[i].pid,
+           ev[i].name, ev[i].frames, ev[i].score, ev[i].trigger);
+    if(ev[i].pid == vpid && ev[i].trigger == gpid) found = 1;
+  }
+  printf(1, "[oomtest] %s\n", found ? "PASS: victim killed for grower" : "FAIL: victim not killed");
+  exit();
+}
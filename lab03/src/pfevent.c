@@ -0,0 +1,121 @@
+// pfevent.c — lock-free per-CPU log of physical frame changes
+//
+// kalloc()/kfree() append one record per frame to the ring of the CPU they
+// run on. Each ring has a single writer (interrupts are off while it
+// writes), so appends take no lock; a global sequence number lets readers
+// merge the rings back into allocation order. Readers keep their own
+// cursor and detect records overwritten under them by re-reading the
+// ring head after the copy.
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "defs.h"
+#include "pfevent.h"
+
+struct pf_ring {
+  volatile uint head;           // Events ever written to this ring
+  struct pfevent ev[PFEV_RING];
+};
+
+static struct pf_ring pf_rings[NCPU];
+static volatile uint pf_seq;
+
+// Append a frame event to this CPU's ring.
+void
+pfev_record(uint pfn, int pid, int event)
+{
+  pushcli();
+  struct pf_ring *r = &pf_rings[cpuid()];
+  uint h = r->head;
+  struct pfevent *e = &r->ev[h & (PFEV_RING - 1)];
+
+  e->seq   = __sync_fetch_and_add(&pf_seq, 1);
+  e->pfn   = pfn;
+  e->pid   = pid;
+  e->event = event;
+  e->tick  = ticks;
+
+  // publish the record before moving the head
+  __sync_synchronize();
+  r->head = h + 1;
+  popcli();
+}
+
+// Move cur past everything logged so far.
+void
+pfev_seek_end(struct pfev_cursor *cur)
+{
+  for(int c = 0; c < ncpu; c++)
+    cur->pos[c] = pf_rings[c].head;
+}
+
+// Copy up to max events after cur into out, oldest first, and advance cur.
+// Events that were overwritten before (or while) being copied are added to
+// cur->lost instead. *consumed is set to the number of ring slots cur moved
+// past. Returns the number of valid events in out.
+int
+pfev_read(struct pfevent *out, int max, struct pfev_cursor *cur, int *consumed)
+{
+  uint head[NCPU];
+  uchar src[64];    // ring each out[] record came from
+  int n = 0, c;
+
+  if(max > NELEM(src)) max = NELEM(src);
+  *consumed = 0;
+
+  // skip what has already been overwritten
+  for(c = 0; c < ncpu; c++){
+    head[c] = pf_rings[c].head;
+    if(head[c] - cur->pos[c] > PFEV_RING){
+      cur->lost += head[c] - cur->pos[c] - PFEV_RING;
+      cur->pos[c] = head[c] - PFEV_RING;
+    }
+  }
+  __sync_synchronize();
+
+  // merge the rings by sequence number
+  uint start[NCPU];
+  for(c = 0; c < ncpu; c++)
+    start[c] = cur->pos[c];
+  while(n < max){
+    int best = -1;
+    uint bseq = 0;
+    for(c = 0; c < ncpu; c++){
+      if(cur->pos[c] == head[c]) continue;
+      uint s = pf_rings[c].ev[cur->pos[c] & (PFEV_RING - 1)].seq;
+      if(best < 0 || (int)(s - bseq) < 0){
+        best = c;
+        bseq = s;
+      }
+    }
+    if(best < 0) break;
+    out[n] = pf_rings[best].ev[cur->pos[best] & (PFEV_RING - 1)];
+    src[n] = best;
+    cur->pos[best]++;
+    n++;
+  }
+  *consumed = n;
+  __sync_synchronize();
+
+  // drop records the writers may have overwritten during the copy,
+  // counting the slot of one still being written (head not yet bumped)
+  uint skip[NCPU];
+  for(c = 0; c < ncpu; c++){
+    uint h2 = pf_rings[c].head;
+    skip[c] = 0;
+    if(h2 + 1 - start[c] > PFEV_RING)
+      skip[c] = h2 + 1 - start[c] - PFEV_RING;
+  }
+  int k = 0;
+  for(int i = 0; i < n; i++){
+    if(skip[src[i]] > 0){
+      skip[src[i]]--;
+      cur->lost++;
+      continue;
+    }
+    out[k++] = out[i];
+  }
+  return k;
+}
@@ -0,0 +1,32 @@
+// Physical frame change log (per-CPU rings of kalloc/kfree events)
+#ifndef PFEVENT_H
+#define PFEVENT_H
+
+#include "types.h"
+#include "param.h"
+
+#define PFEV_RING 1024  // events per CPU ring (power of two)
+
+// Event types
+#define PFEV_ALLOC 1
+#define PFEV_FREE  2
+
+// Frame event record
+struct pfevent {
+  uint seq;    // Global sequence number (orders events across CPUs)
+  uint pfn;    // Physical frame number
+  int pid;     // Owner on alloc, previous owner on free (-1 if none)
+  int event;   // PFEV_ALLOC or PFEV_FREE
+  uint tick;   // Tick of the event
+};
+
+// Reader position, kept by the reader (user space) between calls
+struct pfev_cursor {
+  uint pos[NCPU]; // Next event to read from each CPU ring
+  uint lost;      // Events overwritten before this reader got to them
+};
+
+void pfev_record(uint pfn, int pid, int event);
+void pfev_seek_end(struct pfev_cursor *cur);
+int  pfev_read(struct pfevent *out, int max, struct pfev_cursor *cur, int *consumed);
+#endif
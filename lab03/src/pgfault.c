@@ -0,0 +1,66 @@
+// pgfault.c — page-fault counters and rdtsc latency histograms
+//
+// trap() times every T_PGFLT with rdtsc and files it under its type on the
+// CPU that took it. Each CPU only touches its own counters, from trap()
+// with interrupts off, so recording needs no lock; readers sum over CPUs
+// and may see a fault that is half recorded, which is fine for statistics.
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "pgfault.h"
+
+static struct fault_cpu fault_cpus[NCPU];
+
+// add a 32-bit amount to a split 64-bit counter
+static void
+add64(uint *lo, uint *hi, uint v)
+{
+  uint old = *lo;
+  *lo = old + v;
+  if(*lo < old)
+    (*hi)++;
+}
+
+// Record one fault of the given type that took `cycles` cycles.
+// Interrupts must be off.
+void
+fault_record(int type, uint cycles)
+{
+  struct fault_cpu *f = &fault_cpus[cpuid()];
+  int b = 0;
+
+  while(b < FLT_NBUCKET - 1 && (cycles >> (b + 1)) != 0)
+    b++;
+  f->count[type]++;
+  f->hist[type][b]++;
+  add64(&f->cycles_lo[type], &f->cycles_hi[type], cycles);
+}
+
+// Sum the per-CPU counters into out.
+void
+fault_snapshot(struct faultstat *out)
+{
+  memset(out, 0, sizeof(*out));
+  out->ncpu = ncpu;
+  for(int c = 0; c < NCPU; c++){
+    struct fault_cpu *f = &fault_cpus[c];
+    for(int t = 0; t < FLT_NTYPE; t++){
+      out->count[c][t] = f->count[t];
+      for(int b = 0; b < FLT_NBUCKET; b++)
+        out->hist[t][b] += f->hist[t][b];
+      add64(&out->cycles_lo[t], &out->cycles_hi[t], f->cycles_lo[t]);
+      out->cycles_hi[t] += f->cycles_hi[t];
+    }
+  }
+}
+
+// Zero all counters (between benchmark runs).
+void
+fault_reset(void)
+{
+  memset(fault_cpus, 0, sizeof(fault_cpus));
+}
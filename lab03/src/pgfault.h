@@ -0,0 +1,50 @@
+// Page-fault counters and latency histograms (per CPU, by fault type)
+#ifndef PGFAULT_H
+#define PGFAULT_H
+
+#include "types.h"
+#include "param.h"
+
+// cow_fault() results
+#define COW_COPIED 1    // page copied
+#define COW_REUSED 2    // last mapper: made writable in place
+
+// Fault types
+#define FLT_COW_COPY  0 // write to a shared COW page, copied
+#define FLT_COW_REUSE 1 // write to a COW page nobody else maps any more
+#define FLT_ZERO      2 // demand-zero fill of a madvise() hole
+#define FLT_FATAL     3 // unresolved: process killed (or kernel panic)
+#define FLT_STACK     4 // user stack grown into its reservation
+#define FLT_NTYPE     5
+
+#define FLT_NBUCKET   32 // log2(cycles) buckets
+
+// Per-CPU counters; only the owning CPU writes them, with interrupts off
+struct fault_cpu {
+  uint count[FLT_NTYPE];
+  uint hist[FLT_NTYPE][FLT_NBUCKET];  // hist[t][b]: faults of 2^b..2^(b+1)-1 cycles
+  uint cycles_lo[FLT_NTYPE];          // 64-bit cycle totals, split for user space
+  uint cycles_hi[FLT_NTYPE];
+};
+
+// Snapshot returned by the faultstat system call
+struct faultstat {
+  uint count[NCPU][FLT_NTYPE];        // per-CPU fault counts
+  uint hist[FLT_NTYPE][FLT_NBUCKET];  // all CPUs
+  uint cycles_lo[FLT_NTYPE];          // all CPUs, total cycles spent
+  uint cycles_hi[FLT_NTYPE];
+  int ncpu;                           // CPUs present
+};
+
+static inline uint
+rdtsc_lo(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return lo;
+}
+
+void fault_record(int type, uint cycles);
+void fault_snapshot(struct faultstat *out);
+void fault_reset(void);
+#endif
@@ -7,6 +7,7 @@
 #include "proc.h"
 #include "spinlock.h"
 #include "softtlb.h"
+#include "forkpolicy.h"
 
 struct {
   struct spinlock lock;
@@ -18,6 +19,7 @@ static struct proc *initproc;
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
+extern pde_t *kpgdir;
 
 static void wakeup1(void *chan);
 
@@ -90,6 +92,26 @@ found:
   p->state = EMBRYO;
   p->pid = nextpid++;
 
+  // Initialize working-set estimates
+  p->ws_pages = 0;
+  p->ws_avg = 0;
+  p->dirty_pages = 0;
+  p->dirty_avg = 0;
+  p->ws_scans = 0;
+  p->fault_around = 0;
+  p->oom_adj = 0;
+  p->oom_killed = 0;
+  p->fork_policy = FORK_COW;
+  p->fork_wfrac = 0;
+  p->fork_count = 0;
+  p->fork_pgdir = 0;
+  p->fork_pages = 0;
+  p->cow_faults = 0;
+  p->stack_limit = USTACK_PAGES;
+  p->stack_base = 0;
+  p->stack_lo = 0;
+  p->stack_top = 0;
+
   release(&ptable.lock);
 
   // Allocate kernel stack.
@@ -175,6 +197,53 @@ growproc(int n)
   return 0;
 }
 
+// Grow the current process's stack down to cover va, if va lies in the
+// stack reservation made by exec. A user fault must hit the guard page
+// right below the stack (strict), so a wild pointer into the reservation
+// is not mistaken for growth; the kernel writing into a large user buffer
+// on the stack may reach further down. Returns 1 if va is now mapped, 0 if
+// va is not stack, -1 on overflow, a skipped guard or out of memory.
+int
+growstack(uint va, int strict)
+{
+  struct proc *curproc = myproc();
+  uint a = PGROUNDDOWN(va);
+
+  // stack territory: the reservation plus the guard page below it
+  if(curproc->stack_top == 0 || a >= curproc->stack_lo || a + PGSIZE < curproc->stack_base)
+    return 0;
+
+  uint floor = curproc->stack_top - curproc->stack_limit*PGSIZE;
+  if(floor < curproc->stack_base || curproc->stack_limit*PGSIZE > curproc->stack_top)
+    floor = curproc->stack_base;
+  if(a < floor)
+    return -1;  // stack overflow
+  if(strict && a != curproc->stack_lo - PGSIZE)
+    return -1;  // below the guard page
+
+  if(allocuvm(curproc->pgdir, a, curproc->stack_lo) == 0)
+    return -1;
+  curproc->stack_lo = a;  // the guard page moves down
+  return 1;
+}
+
+// Should a fork of p copy its memory now rather than share it COW?
+static int
+fork_eager(struct proc *p)
+{
+  switch(p->fork_policy){
+  case FORK_EAGER:
+    return 1;
+  case FORK_ADAPTIVE:
+    if(p->sz <= FORK_SMALL_PAGES * PGSIZE)
+      return 1;
+    if(++p->fork_count % FORK_PROBE == 0)
+      return 0;  // keep the estimate fresh
+    return p->fork_wfrac >= FORK_EAGER_PCT;
+  }
+  return 0;
+}
+
 // Create a new process copying p as the parent.
 // Sets up stack to return as if from system call.
 // Caller must set state of returned proc to RUNNABLE.
@@ -191,13 +260,31 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm_cow(curproc->pgdir, curproc->sz)) == 0){  // COW 
+  int eager = fork_eager(curproc);
+  if(eager)
+    np->pgdir = copyuvm(curproc->pgdir, curproc->sz);
+  else
+    np->pgdir = copyuvm_cow(curproc->pgdir, curproc->sz);  // COW
+  if(np->pgdir == 0){
     kfree(np->kstack);
     np->kstack = 0;
     np->state = UNUSED;
     return -1;
   }
   np->sz = curproc->sz;
+  np->stack_limit = curproc->stack_limit;
+  np->stack_base = curproc->stack_base;
+  np->stack_lo = curproc->stack_lo;
+  np->stack_top = curproc->stack_top;
+  np->fork_policy = curproc->fork_policy;
+  np->fork_wfrac = curproc->fork_wfrac;
+  if(!eager){
+    // measure how much of the shared memory this child ends up writing
+    np->fork_pgdir = np->pgdir;
+    np->fork_pages = curproc->sz / PGSIZE;
+  }
+  np->fault_around = curproc->fault_around;
+  np->oom_adj = curproc->oom_adj;
   np->parent = curproc;
   *np->tf = *curproc->tf;
 
@@ -215,6 +302,7 @@ fork(void)
 
   acquire(&ptable.lock);
 
+  np->parked = 1;   // it has yet to run any kernel code of its own
   np->state = RUNNABLE;
 
   release(&ptable.lock);
@@ -254,8 +342,25 @@ exit(void)
     stlb_printstats();
   }
 
+  // An OOM victim gives its frames back now rather than at the parent's
+  // wait(); the kernel page table stands in until the final sched().
+  if(curproc->oom_killed){
+    pde_t *pgdir = curproc->pgdir;
+    curproc->pgdir = kpgdir;
+    switchuvm(curproc);
+    freevm(pgdir);
+  }
+
   acquire(&ptable.lock);
 
+  // Tell the parent what share of a COW fork's memory this child wrote
+  if(curproc->fork_pages > 0){
+    struct proc *pp = curproc->parent;
+    uint pct = curproc->cow_faults * 100 / curproc->fork_pages;
+    if(pct > 100) pct = 100;
+    pp->fork_wfrac = (pp->fork_wfrac * ((1 << FORK_EWMA_SHIFT) - 1) + pct) >> FORK_EWMA_SHIFT;
+  }
+
   // Parent might be sleeping in wait().
   wakeup1(curproc->parent);
 
@@ -296,7 +401,8 @@ wait(void)
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
-        freevm(p->pgdir);
+        if(p->pgdir != kpgdir)
+          freevm(p->pgdir);
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
@@ -314,6 +420,7 @@ wait(void)
     }
 
     // Wait for children to exit.  (See wakeup1 call in proc_exit.)
+    curproc->parked = 1;
     sleep(curproc, &ptable.lock);  //DOC: wait-sleep
   }
 }
@@ -349,6 +456,7 @@ scheduler(void)
       c->proc = p;
       switchuvm(p);
       p->state = RUNNING;
+      p->parked = 0;
 
       swtch(&(c->scheduler), p->context);
       switchkvm();
@@ -0,0 +1,88 @@
+// Per-CPU state
+struct cpu {
+  uchar apicid;                // Local APIC ID
+  struct context *scheduler;   // swtch() here to enter scheduler
+  struct taskstate ts;         // Used by x86 to find stack for interrupt
+  struct segdesc gdt[NSEGS];   // x86 global descriptor table
+  volatile uint started;       // Has the CPU started?
+  int ncli;                    // Depth of pushcli nesting.
+  int intena;                  // Were interrupts enabled before pushcli?
+  struct proc *proc;           // The process running on this cpu or null
+};
+
+extern struct cpu cpus[NCPU];
+extern int ncpu;
+
+//PAGEBREAK: 17
+// Saved registers for kernel context switches.
+// Don't need to save all the segment registers (%cs, etc),
+// because they are constant across kernel contexts.
+// Don't need to save %eax, %ecx, %edx, because the
+// x86 convention is that the caller has saved them.
+// Contexts are stored at the bottom of the stack they
+// describe; the stack pointer is the address of the context.
+// The layout of the context matches the layout of the stack in swtch.S
+// at the "Switch stacks" comment. Switch doesn't save eip explicitly,
+// but it is on the stack and allocproc() manipulates it.
+struct context {
+  uint edi;
+  uint esi;
+  uint ebx;
+  uint ebp;
+  uint eip;
+};
+
+enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
+
+#define USTACK_PAGES     64    // default stack limit (pages)
+#define USTACK_MAX_PAGES 4096  // largest settable stack limit (16MB)
+
+// Per-process state
+struct proc {
+  uint sz;                     // Size of process memory (bytes)
+  pde_t* pgdir;                // Page table
+  char *kstack;                // Bottom of kernel stack for this process
+  enum procstate state;        // Process state
+  int pid;                     // Process ID
+  struct proc *parent;         // Parent process
+  struct trapframe *tf;        // Trap frame for current syscall
+  struct context *context;     // swtch() here to run process
+  void *chan;                  // If non-zero, sleeping on chan
+  int killed;                  // If non-zero, have been killed
+  struct file *ofile[NOFILE];  // Open files
+  struct inode *cwd;           // Current directory
+  char name[16];               // Process name (debugging)
+  int parked;                  // Stopped holding no frame address (see compact.c)
+
+  // Working-set estimation (see wss.c)
+  uint ws_pages;               // Pages referenced in the last scan window
+  uint ws_avg;                 // Smoothed working set (pages)
+  uint dirty_pages;            // Pages written in the last scan window
+  uint dirty_avg;              // Smoothed dirty pages per window
+  uint ws_scans;               // Number of scan windows observed
+
+  uint fault_around;           // Extra pages mapped per zero-fill fault (madvise)
+
+  int oom_adj;                 // OOM score bias, -1000 (never) .. 1000 (first)
+  int oom_killed;              // Killed by the OOM killer; frees memory in exit()
+
+  // fork() copy policy (see forkpolicy.h)
+  int fork_policy;             // FORK_COW, FORK_EAGER or FORK_ADAPTIVE
+  uint fork_wfrac;             // Smoothed % of their memory children wrote
+  uint fork_count;             // Adaptive forks so far (for COW probes)
+  pde_t *fork_pgdir;           // Address space a COW fork gave us (until exec)
+  uint fork_pages;             // Pages shared with the parent at that fork
+  uint cow_faults;             // COW faults taken in fork_pgdir
+
+  // Growable user stack (reserved by exec, see growstack())
+  uint stack_limit;            // Max stack pages; size of the next exec's reservation
+  uint stack_base;             // Lowest address the stack may grow to
+  uint stack_lo;               // Lowest mapped stack page
+  uint stack_top;              // Top of the stack (0 if no reservation)
+};
+
+// Process memory is laid out contiguously, low addresses first:
+//   text
+//   original data and bss
+//   fixed-size stack
+//   expandable heap
@@ -0,0 +1,52 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+static void
+usage(void)
+{
+  printf(1, "usage: psmem [-r rounds] pid [pid ...]\n");
+  exit();
+}
+
+static void
+show(int pid)
+{
+  struct procinfo info;
+
+  if(get_procinfo(pid, &info) < 0){
+    printf(1, "%d\t(no such process)\n", pid);
+    return;
+  }
+  printf(1, "%d\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n", info.pid, info.name,
+         info.sz / 4096, info.rss_pages, info.shared_pages, info.cow_pages, info.pt_pages,
+         info.ws_pages, info.ws_avg, info.dirty_pages, info.dirty_avg);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds = 1;
+  int i = 1;
+
+  if(argc > 2 && strcmp(argv[1], "-r") == 0){
+    rounds = atoi(argv[2]);
+    i = 3;
+  }
+  if(i >= argc || rounds <= 0) usage();
+
+  struct procinfo self;
+  if(get_procinfo(0, &self) < 0){
+    printf(1, "psmem: get_procinfo failed\n");
+    exit();
+  }
+
+  for(int r = 0; r < rounds; r++){
+    if(r > 0) sleep(self.ws_window);
+    printf(1, "[psmem] window=%d ticks\n", self.ws_window);
+    printf(1, "[pid]\t[name]\t[pages]\t[rss]\t[shared]\t[cow]\t[pt]\t[ws]\t[ws_avg]\t[dirty]\t[dirty_avg]\n");
+    for(int k = i; k < argc; k++)
+      show(atoi(argv[k]));
+  }
+  exit();
+}
@@ -0,0 +1,101 @@
+// rss.c — incremental frame accounting per address space
+//
+// Counters are keyed by page directory rather than by process: a pgdir
+// exists before its process sees it (fork, exec) and checkpoints have one
+// with no process at all. get_procinfo() and the OOM policy read them in
+// O(1) through a small open-addressed hash.
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "defs.h"
+#include "rss.h"
+
+#define RSS_TOMB ((pde_t*)1)  // deleted slot marker
+#define RSS_HASH(pg) ((((uint)(pg)) >> 12) & (RSS_NSLOT - 1))
+
+static struct rss rss_tab[RSS_NSLOT];
+static struct spinlock rss_lock;
+static int rss_ready; // set once locks can be taken (after mpinit)
+
+// Initialize the accounting table.
+void
+rss_init(void)
+{
+  initlock(&rss_lock, "rss");
+  for(int i = 0; i < RSS_NSLOT; i++)
+    rss_tab[i].pgdir = 0;
+  rss_ready = 1;
+}
+
+// find pgdir's slot; rss_lock must be held
+static struct rss*
+rss_find(pde_t *pgdir)
+{
+  uint h = RSS_HASH(pgdir);
+  for(int i = 0; i < RSS_NSLOT; i++){
+    struct rss *r = &rss_tab[(h + i) & (RSS_NSLOT - 1)];
+    if(r->pgdir == pgdir) return r;
+    if(r->pgdir == 0) return 0;
+  }
+  return 0;
+}
+
+// Start accounting for a new address space.
+void
+rss_register(pde_t *pgdir)
+{
+  if(!rss_ready) return;
+
+  uint h = RSS_HASH(pgdir);
+  acquire(&rss_lock);
+  for(int i = 0; i < RSS_NSLOT; i++){
+    struct rss *r = &rss_tab[(h + i) & (RSS_NSLOT - 1)];
+    if(r->pgdir == 0 || r->pgdir == RSS_TOMB){
+      r->pgdir = pgdir;
+      for(int f = 0; f < RSS_NFIELD; f++)
+        r->cnt[f] = 0;
+      break;
+    }
+  }
+  release(&rss_lock);
+}
+
+// Stop accounting for an address space (called from freevm).
+void
+rss_unregister(pde_t *pgdir)
+{
+  if(!rss_ready) return;
+
+  acquire(&rss_lock);
+  struct rss *r = rss_find(pgdir);
+  if(r) r->pgdir = RSS_TOMB;
+  release(&rss_lock);
+}
+
+// Adjust one counter of pgdir.
+void
+rss_add(pde_t *pgdir, int field, int delta)
+{
+  if(!rss_ready) return;
+
+  acquire(&rss_lock);
+  struct rss *r = rss_find(pgdir);
+  if(r) r->cnt[field] += delta;
+  release(&rss_lock);
+}
+
+// Copy pgdir's counters into out[RSS_NFIELD]. Returns -1 if unknown.
+int
+rss_get(pde_t *pgdir, int *out)
+{
+  if(!rss_ready) return -1;
+
+  acquire(&rss_lock);
+  struct rss *r = rss_find(pgdir);
+  if(r)
+    for(int f = 0; f < RSS_NFIELD; f++)
+      out[f] = r->cnt[f];
+  release(&rss_lock);
+  return r ? 0 : -1;
+}
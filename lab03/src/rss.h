@@ -0,0 +1,27 @@
+// Per-address-space frame accounting (resident/shared/COW/page-table pages)
+#ifndef RSS_H
+#define RSS_H
+
+#include "types.h"
+
+#define RSS_NSLOT 256   // hash slots (> NPROC + NMCKPT, power of two)
+
+// Counter fields
+#define RSS_RESIDENT 0  // present user pages
+#define RSS_SHARED   1  // present user pages whose frame has IPT refcnt > 1
+#define RSS_COW      2  // read-only user pages waiting for a COW fault
+#define RSS_PTPAGES  3  // page directory + page-table pages
+#define RSS_NFIELD   4
+
+// Accounting entry
+struct rss {
+  pde_t *pgdir;         // Address space (0 if free)
+  int cnt[RSS_NFIELD];  // Counters, indexed by RSS_*
+};
+
+void rss_init(void);
+void rss_register(pde_t *pgdir);
+void rss_unregister(pde_t *pgdir);
+void rss_add(pde_t *pgdir, int field, int delta);
+int  rss_get(pde_t *pgdir, int *out);
+#endif
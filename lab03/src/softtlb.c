@@ -136,6 +136,33 @@ stlb_invalidate_all_of(pde_t *pgdir)
   release(&stlb_lock);
 }
 
+// Invalidate the entries of pgdir for va[0..n-1] under a single lock hold.
+// The entry pages are freed as one list afterwards.
+void
+stlb_invalidate_batch(pde_t *pgdir, uint *va, int n)
+{
+  char *junk = 0;
+
+  acquire(&stlb_lock);
+  for(int i = 0; i < n; i++){
+    uint vpg = vpage(va[i]);
+    struct stlb_entry **pp = &stlb_bkt[STLB_HASH(pgdir, vpg)];
+    while(*pp){
+      struct stlb_entry *e = *pp;
+      if(e->pgdir == pgdir && e->vpg == vpg){
+        *pp = e->next;
+        *(char**)e = junk;   // chain for kfree_list
+        junk = (char*)e;
+        break;               // unique key; stop
+      }
+      pp = &(*pp)->next;
+    }
+  }
+  release(&stlb_lock);
+
+  kfree_list(junk);
+}
+
 // Get software TLB statistics
 void
 stlb_stats(uint *hits, uint *misses)
@@ -14,6 +14,7 @@ int  stlb_lookup(pde_t *pgdir, uint vpg, uint *ppg_out, uint *flags_out); // Loo
 void stlb_insert(pde_t *pgdir, uint vpg, uint ppg, uint flags); // Insert (pgdir,vpg) -> (ppg,flags)
 void stlb_invalidate_one(pde_t *pgdir, uint vpg); // Invalidate one entry for (pgdir,vpg)
 void stlb_invalidate_all_of(pde_t *pgdir); // Invalidate all entries of pgdir
+void stlb_invalidate_batch(pde_t *pgdir, uint *va, int n); // Invalidate n entries of pgdir, one lock hold
 
 void stlb_stats(uint *hits, uint *misses);  // Get STLB hit/miss statistics
 void stlb_printstats(void); // Print STLB hit/miss statistics
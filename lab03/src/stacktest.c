@@ -0,0 +1,124 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+#include "madvise.h"
+
+#define FRAME 512  // bytes of locals per recursion level
+
+// print this process's frame usage with memdump -s -p <pid>
+static void
+memdump_self(const char *phase)
+{
+  char pidbuf[16], tmp[16];
+  int k = 0, v = getpid();
+
+  do { tmp[k++] = '0' + v % 10; v /= 10; } while(v);
+  for(int j = 0; j < k; j++) pidbuf[j] = tmp[k - 1 - j];
+  pidbuf[k] = 0;
+
+  printf(1, "[stacktest] %s\n", phase);
+  int pid = fork();
+  if(pid < 0) fail("fork");
+  if(pid == 0){
+    char *argv[] = { "memdump", "-s", "-p", pidbuf, 0 };
+    exec("memdump", argv);
+    fail("exec memdump");
+  }
+  wait();
+}
+
+// recurse depth levels, touching FRAME bytes of stack each; at the
+// bottom optionally report memory usage
+static int
+recurse(int depth, int report)
+{
+  volatile char buf[FRAME];
+
+  buf[0] = (char)depth;
+  buf[FRAME - 1] = (char)depth;
+  if(depth == 0){
+    if(report) memdump_self("at maximum depth");
+    return buf[0];
+  }
+  return recurse(depth - 1, report) + buf[FRAME - 1];
+}
+
+static void
+stackinfo(const char *phase)
+{
+  struct procinfo info;
+  if(get_procinfo(0, &info) < 0) fail("get_procinfo");
+  printf(1, "[stacktest] %s: stack=%d pages (limit %d), rss=%d\n",
+         phase, info.stack_pages, info.stack_limit, info.rss_pages);
+}
+
+// Fork a child that recurses past its stack limit; returns 1 if it was
+// killed. With prefault set the child first asks for everything below
+// its stack top with MADV_WILLNEED, then has write() read from the
+// lowest reserved page so the kernel grows the stack all the way down.
+// A child that survives, or fails one of those calls, writes to the pipe.
+static int
+overflow(int prefault)
+{
+  int fds[2];
+  char c = 0;
+
+  if(pipe(fds) < 0) fail("pipe");
+  int pid = fork();
+  if(pid < 0) fail("fork");
+  if(pid == 0){
+    close(fds[0]);
+    struct procinfo info;
+    get_procinfo(0, &info);
+    if(prefault){
+      uint top = (uint)sbrk(0);   // no heap: the stack ends the address space
+      uint low = top - info.stack_limit * 4096;
+      int p2[2];
+      if(pipe(p2) < 0 || madvise(0, top, MADV_WILLNEED) < 0 ||
+         write(p2[1], (char*)low, 1) != 1){
+        write(fds[1], &c, 1);
+        exit();
+      }
+    }
+    recurse(info.stack_limit * 4096 / FRAME + 16, 0);
+    write(fds[1], &c, 1);  // only reached if the limit did not hold
+    exit();
+  }
+  close(fds[1]);
+  int n = read(fds[0], &c, 1);
+  wait();
+  close(fds[0]);
+  return n == 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int depth = 200;  // ~100KB of stack, within the default limit
+  int run_memdump = 0;
+
+  benchinit("stacktest", "[-d depth] [-m]");
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i], "-d") == 0 && i + 1 < argc) depth = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-m") == 0) run_memdump = 1;
+    else usage();
+  }
+  if(depth <= 0) usage();
+
+  // 1. deep recursion grows the stack on demand
+  stackinfo("before");
+  if(run_memdump) memdump_self("before recursion");
+  recurse(depth, run_memdump);
+  stackinfo("after");
+
+  // 2. recursion past the limit kills the child instead of corrupting memory
+  printf(1, "[stacktest] overflow child %s\n", overflow(0) ? "killed: PASS" : "survived: FAIL");
+
+  // 3. madvise(MADV_WILLNEED) over the whole stack reservation must not
+  // map the guard: the kernel can still grow the stack into the range,
+  // and recursion past the limit is still stopped
+  printf(1, "[stacktest] overflow after MADV_WILLNEED %s\n",
+         overflow(1) ? "killed: PASS" : "survived: FAIL");
+  exit();
+}
@@ -21,6 +21,8 @@ fetchint(uint addr, int *ip)
 
   if(addr >= curproc->sz || addr+4 > curproc->sz)
     return -1;
+  if(uvm_prepare(addr, 4, 0) < 0)
+    return -1;
   *ip = *(int*)(addr);
   return 0;
 }
@@ -39,6 +41,8 @@ fetchstr(uint addr, char **pp)
   *pp = (char*)addr;
   ep = (char*)curproc->sz;
   for(s = *pp; s < ep; s++){
+    if((s == *pp || ((uint)s % PGSIZE) == 0) && uvm_prepare((uint)s, 1, 0) < 0)
+      return -1;
     if(*s == 0)
       return s - *pp;
   }
@@ -52,19 +56,31 @@ argint(int n, int *ip)
   return fetchint((myproc()->tf->esp) + 4 + 4*n, ip);
 }
 
+// System calls that store through their argptr() buffers, some with a
+// spinlock held (piperead, consoleread), so argptr makes the pages
+// private first. The rest only read them, or write with copyout().
+static char argptr_writes[] = {
+[SYS_pipe]    1,
+[SYS_read]    1,
+[SYS_fstat]   1,
+};
+
 // Fetch the nth word-sized system call argument as a pointer
 // to a block of memory of size bytes.  Check that the pointer
 // lies within the process address space.
 int
 argptr(int n, char **pp, int size)
 {
-  int i;
+  int i, num;
   struct proc *curproc = myproc();
  
   if(argint(n, &i) < 0)
     return -1;
   if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
     return -1;
+  num = curproc->tf->eax;   // the system call being served
+  if(uvm_prepare(i, size, num < NELEM(argptr_writes) && argptr_writes[num]) < 0)
+    return -1;
   *pp = (char*)i;
   return 0;
 }
@@ -106,6 +122,19 @@ extern int sys_uptime(void);
 extern int sys_dump_physmem_info(void); // Declaration for physical frame tracking
 extern int sys_vtop(void);              // Declaration for virtual to physical address translation
 extern int sys_phys2virt(void);         // Declaration for physical to virtual address translation
+extern int sys_mcheckpoint(void);       // Declaration for address-space checkpoint
+extern int sys_mrestore(void);          // Declaration for address-space restore
+extern int sys_mdiscard(void);          // Declaration for dropping a checkpoint
+extern int sys_get_procinfo(void);      // Declaration for per-process memory statistics
+extern int sys_madvise(void);           // Declaration for memory usage hints
+extern int sys_physmem_events(void);    // Declaration for streaming physical frame changes
+extern int sys_oom_adjust(void);        // Declaration for OOM victim selection bias
+extern int sys_oom_events(void);        // Declaration for reading the OOM kill log
+extern int sys_faultstat(void);         // Declaration for page-fault counters and latency histograms
+extern int sys_compact(void);           // Declaration for physical memory compaction
+extern int sys_setforkpolicy(void);     // Declaration for selecting the fork() copy policy
+extern int sys_setstacklimit(void);     // Declaration for the growable user stack limit
+extern int sys_vtopbench(void);         // Declaration for the walk vs. IPT hash translation benchmark
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -132,6 +161,19 @@ static int (*syscalls[])(void) = {
 [SYS_dump_physmem_info] sys_dump_physmem_info, // Mapping for physical frame tracking
 [SYS_vtop]    sys_vtop,                        // Mapping for virtual to physical address translation
 [SYS_phys2virt] sys_phys2virt,                 // Mapping for physical to virtual address translation
+[SYS_mcheckpoint] sys_mcheckpoint,             // Mapping for address-space checkpoint
+[SYS_mrestore] sys_mrestore,                   // Mapping for address-space restore
+[SYS_mdiscard] sys_mdiscard,                   // Mapping for dropping a checkpoint
+[SYS_get_procinfo] sys_get_procinfo,           // Mapping for per-process memory statistics
+[SYS_madvise] sys_madvise,                     // Mapping for memory usage hints
+[SYS_physmem_events] sys_physmem_events,       // Mapping for streaming physical frame changes
+[SYS_oom_adjust] sys_oom_adjust,               // Mapping for OOM victim selection bias
+[SYS_oom_events] sys_oom_events,               // Mapping for reading the OOM kill log
+[SYS_faultstat] sys_faultstat,                 // Mapping for page-fault counters and latency histograms
+[SYS_compact] sys_compact,                     // Mapping for physical memory compaction
+[SYS_setforkpolicy] sys_setforkpolicy,         // Mapping for selecting the fork() copy policy
+[SYS_setstacklimit] sys_setstacklimit,         // Mapping for the growable user stack limit
+[SYS_vtopbench] sys_vtopbench,                 // Mapping for the walk vs. IPT hash translation benchmark
 };
 
 void
@@ -22,4 +22,17 @@
 #define SYS_close  21
 #define SYS_dump_physmem_info 22 // Added for physical frame tracking
 #define SYS_vtop  23             // Added for virtual to physical address translation
-#define SYS_phys2virt 24         // Added for getting virtual addresses mapping to a physical page
\ No newline at end of file
+#define SYS_phys2virt 24         // Added for getting virtual addresses mapping to a physical page
+#define SYS_mcheckpoint 25       // Added for address-space checkpoint
+#define SYS_mrestore 26          // Added for address-space restore
+#define SYS_mdiscard 27          // Added for dropping an address-space checkpoint
+#define SYS_get_procinfo 28      // Added for per-process memory statistics
+#define SYS_madvise 29           // Added for memory usage hints
+#define SYS_physmem_events 30    // Added for streaming physical frame changes
+#define SYS_oom_adjust 31        // Added for OOM victim selection bias
+#define SYS_oom_events 32        // Added for reading the OOM kill log
+#define SYS_faultstat 33         // Added for page-fault counters and latency histograms
+#define SYS_compact 34           // Added for physical memory compaction
+#define SYS_setforkpolicy 35     // Added for selecting the fork() copy policy
+#define SYS_setstacklimit 36     // Added for the growable user stack limit
+#define SYS_vtopbench 37         // Added for the walk vs. IPT hash translation benchmark
\ No newline at end of file
@@ -10,6 +10,15 @@
 #include "pframe.h" // for pframe_lookup
 #include "ipt.h"   // for ipt_lookup
 #include "softtlb.h" // for software TLB functions
+#include "mckpt.h"   // for address-space checkpoints
+#include "wss.h"     // for working-set estimates
+#include "madvise.h" // for madvise advice values
+#include "oom.h"     // for the OOM kill log
+#include "pgfault.h" // for page-fault statistics
+#include "compact.h" // for physical memory compaction
+#include "forkpolicy.h" // for fork() copy policies
+#include "pfevent.h" // for the physical frame change log
+#include "rss.h"     // for per-address-space frame accounting
 
 // physmem_info system call
 int
@@ -45,6 +54,43 @@ sys_dump_physmem_info(void)
   return n;
 }
 
+// physmem_events system call: stream frame changes since *cursor.
+// With n == 0 the cursor is moved to the current end of the log.
+int
+sys_physmem_events(void)
+{
+  int uaddr, max;
+  char *ucur;
+  struct pfev_cursor cur;
+  struct pfevent kbuf[32];
+  int total = 0;
+
+  // Fetch the system call arguments
+  if(argint(0, &uaddr) < 0) return -1;
+  if(argint(1, &max) < 0) return -1;
+  if(argptr(2, &ucur, sizeof(cur)) < 0) return -1;
+  if(max < 0) return -1;
+  memmove(&cur, ucur, sizeof(cur));
+  if(max == 0)
+    pfev_seek_end(&cur);
+
+  // copy out in chunks until the rings are drained or the buffer is full
+  while(total < max){
+    int want = max - total, consumed;
+    if(want > NELEM(kbuf)) want = NELEM(kbuf);
+    int k = pfev_read(kbuf, want, &cur, &consumed);
+    if(consumed == 0) break;
+    if(k > 0 && copyout(myproc()->pgdir, (uint)(uaddr + total * sizeof(struct pfevent)),
+                        (void*)kbuf, k * sizeof(struct pfevent)) < 0)
+      return -1;
+    total += k;
+  }
+
+  // hand the cursor back
+  if(copyout(myproc()->pgdir, (uint)ucur, (void*)&cur, sizeof(cur)) < 0) return -1;
+  return total;
+}
+
 // vtop system call
 extern int sw_vtop(pde_t *pgdir, const void *va, uint *pa, uint *flags);
 int
@@ -133,6 +179,292 @@ sys_phys2virt(void)
   return n;
 }
 
+// mcheckpoint system call
+int
+sys_mcheckpoint(void)
+{
+  return mckpt_create(myproc());
+}
+
+// mrestore system call: on success the process resumes at its
+// mcheckpoint() call, which returns 0
+int
+sys_mrestore(void)
+{
+  int id;
+
+  if(argint(0, &id) < 0) return -1;
+  return mckpt_restore(myproc(), id);
+}
+
+// mdiscard system call
+int
+sys_mdiscard(void)
+{
+  int id;
+
+  if(argint(0, &id) < 0) return -1;
+  return mckpt_discard(myproc(), id);
+}
+
+// kernel-side copy of struct procinfo (user.h)
+struct k_procinfo {
+  int pid, ppid, state;
+  uint sz;
+  char name[16];
+  uint ws_pages, ws_avg;
+  uint dirty_pages, dirty_avg;
+  uint ws_window;
+  int rss_pages, shared_pages, cow_pages, pt_pages;
+  int fork_policy;
+  uint fork_wfrac;
+  uint stack_pages, stack_limit;
+};
+
+// get_procinfo system call: pid <= 0 is "self"
+int
+sys_get_procinfo(void)
+{
+  int pid;
+  char *uaddr;
+  struct proc *p, *t;
+  struct k_procinfo kinfo;
+
+  if(argint(0, &pid) < 0) return -1;
+  if(argptr(1, &uaddr, sizeof(struct k_procinfo)) < 0) return -1;
+
+  acquire(&ptable.lock);
+  if(pid <= 0) t = myproc();
+  else {
+    t = 0;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+      if(p->pid == pid){ t = p; break; }
+  }
+  if(t == 0 || t->state == UNUSED){
+    release(&ptable.lock);
+    return -1;
+  }
+
+  // fill kernel-side struct
+  kinfo.pid = t->pid;
+  kinfo.ppid = t->parent ? t->parent->pid : 0;
+  kinfo.state = t->state;
+  kinfo.sz = t->sz;
+  safestrcpy(kinfo.name, t->name, sizeof(kinfo.name));
+  kinfo.ws_pages = t->ws_pages;
+  kinfo.ws_avg = t->ws_avg;
+  kinfo.dirty_pages = t->dirty_pages;
+  kinfo.dirty_avg = t->dirty_avg;
+  kinfo.ws_window = WSS_INTERVAL;
+
+  // O(1) frame accounting of the address space
+  int cnt[RSS_NFIELD] = { 0 };
+  if(t->pgdir) rss_get(t->pgdir, cnt);
+  kinfo.rss_pages = cnt[RSS_RESIDENT];
+  kinfo.shared_pages = cnt[RSS_SHARED];
+  kinfo.cow_pages = cnt[RSS_COW];
+  kinfo.pt_pages = cnt[RSS_PTPAGES];
+  kinfo.fork_policy = t->fork_policy;
+  kinfo.fork_wfrac = t->fork_wfrac;
+  kinfo.stack_pages = t->stack_top ? (t->stack_top - t->stack_lo) / PGSIZE : 0;
+  kinfo.stack_limit = t->stack_limit;
+  release(&ptable.lock);
+
+  // copy to user space
+  if(copyout(myproc()->pgdir, (uint)uaddr, (void*)&kinfo, sizeof(kinfo)) < 0) return -1;
+  return 0;
+}
+
+// madvise system call
+int
+sys_madvise(void)
+{
+  int addr, len, advice;
+  struct proc *p = myproc();
+
+  if(argint(0, &addr) < 0) return -1;
+  if(argint(1, &len) < 0) return -1;
+  if(argint(2, &advice) < 0) return -1;
+
+  // range must be page-aligned and inside the process
+  uint start = (uint)addr;
+  uint end = PGROUNDUP(start + (uint)len);
+  if(start % PGSIZE != 0 || len < 0 || end < start || end > p->sz) return -1;
+
+  // Leave out the stack's unmapped territory, the guard page and the
+  // reservation below stack_lo: only growstack() maps it, moving the guard.
+  uint glo = end, ghi = end;
+  if(p->stack_top != 0){
+    glo = p->stack_base - PGSIZE;
+    ghi = p->stack_lo;
+  }
+  uint lo_end = end < glo ? end : glo;      // [start, lo_end) below it
+  uint hi_start = start > ghi ? start : ghi; // [hi_start, end) above it
+
+  switch(advice){
+  case MADV_NORMAL:
+    p->fault_around = 0;
+    return 0;
+  case MADV_SEQUENTIAL:
+    p->fault_around = MADV_SEQ_PAGES;
+    return 0;
+  case MADV_WILLNEED:
+    if(start < lo_end && prefaultuvm(p->pgdir, start, lo_end) < 0)
+      return -1;
+    if(hi_start < end && prefaultuvm(p->pgdir, hi_start, end) < 0)
+      return -1;
+    return 0;
+  case MADV_DONTNEED:
+    // unmap, drop IPT/STLB entries, free frames
+    if(start < lo_end)
+      deallocuvm(p->pgdir, lo_end, start);
+    if(hi_start < end)
+      deallocuvm(p->pgdir, end, hi_start);
+    lcr3(V2P(p->pgdir));              // flush hardware TLB
+    return 0;
+  }
+  return -1;
+}
+
+// faultstat system call: copy the page-fault statistics to buf (if not
+// null), then zero them if reset is set
+int
+sys_faultstat(void)
+{
+  int uaddr, reset;
+  struct faultstat st;
+
+  if(argint(0, &uaddr) < 0) return -1;
+  if(argint(1, &reset) < 0) return -1;
+
+  if(uaddr != 0){
+    fault_snapshot(&st);
+    if(copyout(myproc()->pgdir, (uint)uaddr, (void*)&st, sizeof(st)) < 0) return -1;
+  }
+  if(reset)
+    fault_reset();
+  return 0;
+}
+
+// compact system call: compact physical memory, report into *st
+int
+sys_compact(void)
+{
+  char *uaddr;
+  struct compact_stats st;
+
+  if(argptr(0, &uaddr, sizeof(st)) < 0) return -1;
+  if(compact(&st) < 0) return -1;
+  if(copyout(myproc()->pgdir, (uint)uaddr, (void*)&st, sizeof(st)) < 0) return -1;
+  return 0;
+}
+
+// setforkpolicy system call: choose how this process's forks copy memory
+// (inherited by children). Returns the previous policy.
+int
+sys_setforkpolicy(void)
+{
+  int policy;
+  struct proc *p = myproc();
+
+  if(argint(0, &policy) < 0) return -1;
+  if(policy != FORK_COW && policy != FORK_EAGER && policy != FORK_ADAPTIVE) return -1;
+
+  int old = p->fork_policy;
+  p->fork_policy = policy;
+  p->fork_count = 0;
+  return old;
+}
+
+// setstacklimit system call: set the stack limit in pages. Lowering it
+// takes effect now; a higher limit applies from the next exec, which
+// reserves that much address space. Returns the previous limit.
+int
+sys_setstacklimit(void)
+{
+  int pages;
+  struct proc *p = myproc();
+
+  if(argint(0, &pages) < 0) return -1;
+  if(pages < 1 || pages > USTACK_MAX_PAGES) return -1;
+  if(p->stack_top && pages*PGSIZE < p->stack_top &&
+     p->stack_top - pages*PGSIZE > p->stack_lo) return -1; // stack already deeper
+
+  int old = p->stack_limit;
+  p->stack_limit = pages;
+  return old;
+}
+
+// vtopbench system call: translate va[0..n) in mode (VTOP_WALK or
+// VTOP_HASH), write the frames to pa[], and return the elapsed cycles
+#define VTOPBENCH_MAX (PGSIZE / (2 * sizeof(uint)))
+int
+sys_vtopbench(void)
+{
+  char *uva, *upa;
+  int n, mode, cycles;
+  struct proc *p = myproc();
+
+  if(argint(2, &n) < 0 || n <= 0 || n > VTOPBENCH_MAX) return -1;
+  if(argint(3, &mode) < 0) return -1;
+  if(argptr(0, &uva, n * sizeof(uint)) < 0) return -1;
+  if(argptr(1, &upa, n * sizeof(uint)) < 0) return -1;
+
+  // one page: addresses in the first half, frames in the second
+  uint *va = (uint*)kalloc();
+  if(va == 0) return -1;
+  uint *pa = va + VTOPBENCH_MAX;
+  memmove(va, uva, n * sizeof(uint));
+
+  cycles = vtop_bench(p->pgdir, va, pa, n, mode);
+  if(cycles >= 0 && copyout(p->pgdir, (uint)upa, (void*)pa, n * sizeof(uint)) < 0)
+    cycles = -1;
+  kfree((char*)va);
+  return cycles;
+}
+
+// oom_adjust system call: set pid's OOM score bias, pid <= 0 is "self"
+int
+sys_oom_adjust(void)
+{
+  int pid, adj, found = 0;
+  struct proc *p;
+
+  if(argint(0, &pid) < 0) return -1;
+  if(argint(1, &adj) < 0) return -1;
+  if(adj < OOM_ADJ_MIN || adj > OOM_ADJ_MAX) return -1;
+  if(pid <= 0) pid = myproc()->pid;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED){
+      p->oom_adj = adj;
+      found = 1;
+      break;
+    }
+  }
+  release(&ptable.lock);
+  return found ? 0 : -1;
+}
+
+// oom_events system call: copy up to n of the most recent OOM kills
+int
+sys_oom_events(void)
+{
+  int uaddr, max;
+  struct oom_event kbuf[OOM_NLOG];
+
+  if(argint(0, &uaddr) < 0) return -1;
+  if(argint(1, &max) < 0) return -1;
+  if(max < 0) return -1;
+  if(max > OOM_NLOG) max = OOM_NLOG;
+
+  int n = oom_read(kbuf, max);
+  if(n > 0 && copyout(myproc()->pgdir, (uint)uaddr, (void*)kbuf, n * sizeof(struct oom_event)) < 0)
+    return -1;
+  return n;
+}
+
 int
 sys_fork(void)
 {
@@ -197,6 +529,7 @@ sys_sleep(void)
       release(&tickslock);
       return -1;
     }
+    myproc()->parked = 1;
     sleep(&ticks, &tickslock);
   }
   release(&tickslock);
@@ -9,6 +9,8 @@
 #include "spinlock.h"
 #include "softtlb.h"
 #include "ipt.h"
+#include "wss.h"
+#include "pgfault.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
@@ -16,6 +18,7 @@ extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
 
+#define FEC_PR 0x1   // page-fault error code: protection (page present)
 #define FEC_WR 0x2   // page-fault error code: write
 #define FEC_US 0x4   // user mode
 
@@ -58,6 +61,7 @@ trap(struct trapframe *tf)
       ticks++;
       wakeup(&ticks);
       release(&tickslock);
+      wss_tick();      // a slice of the working-set scan
     }
     lapiceoi();
     break;
@@ -84,16 +88,37 @@ trap(struct trapframe *tf)
     break;
   case T_PGFLT: // page fault
     {
-      // Handle copy-on-write page fault.
-      if(myproc() && (tf->cs & 3) == DPL_USER) {
-        if((tf->err & FEC_WR) && (tf->err & FEC_US)) {
-          int r = cow_fault(myproc()->pgdir, rcr2());   // rcr2() gives faulting address
-          if(r > 0) return;               // success
-          if(r < 0) myproc()->killed = 1; // failure
+      // The kernel also touches user buffers directly (e.g. read() into a
+      // user array), so faults on user addresses are handled in either mode.
+      struct proc *p = myproc();
+      uint va = rcr2();   // rcr2() gives faulting address
+      uint t0 = rdtsc_lo();
+      int r = 0, type = FLT_FATAL;
+      if(p && va < p->sz) {
+        if((tf->err & FEC_PR) == 0){
+          r = growstack(va, (tf->cs & 3) == DPL_USER);          // stack growth
+          type = FLT_STACK;
+          if(r == 0){
+            r = zero_fault(p->pgdir, p->sz, va, p->fault_around); // madvise() hole
+            type = FLT_ZERO;
+          }
+        } else if(tf->err & FEC_WR){
+          r = cow_fault(p->pgdir, va);                          // copy-on-write
+          type = (r == COW_REUSED) ? FLT_COW_REUSE : FLT_COW_COPY;
+          if(r > 0 && p->pgdir == p->fork_pgdir)
+            p->cow_faults++;                    // feeds the adaptive fork policy
         }
       }
-    } 
-    break;
+      if(r > 0){                            // success
+        fault_record(type, rdtsc_lo() - t0);
+        return;
+      }
+      fault_record(FLT_FATAL, rdtsc_lo() - t0);
+      if(r < 0 && (tf->cs & 3) != DPL_USER)
+        panic("page fault: out of memory in kernel");
+    }
+    // Unresolved: kill the process (or panic if in the kernel) below.
+    // fall through
 
   //PAGEBREAK: 13
   default:
@@ -119,9 +144,12 @@ trap(struct trapframe *tf)
 
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
+  // Preempted in user mode, it holds no frame address until it runs again.
   if(myproc() && myproc()->state == RUNNING &&
-     tf->trapno == T_IRQ0+IRQ_TIMER)
+     tf->trapno == T_IRQ0+IRQ_TIMER){
+    myproc()->parked = (tf->cs&3) == DPL_USER;
     yield();
+  }
 
   // Check if the process has been killed since we yielded
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
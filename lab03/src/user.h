@@ -59,4 +59,103 @@ struct vlist{
     uint flags;           // Page table entry flags
     int refcnt;       // Reference count
 };
-int phys2virt(uint pa_page, struct vlist *out, int max); 
\ No newline at end of file
+int phys2virt(uint pa_page, struct vlist *out, int max);
+
+// Address-space checkpoint/restore
+int mcheckpoint(void);   // returns id (> 0), or 0 when resumed by mrestore
+int mrestore(int id);    // roll back to checkpoint id; does not return on success
+int mdiscard(int id);    // drop checkpoint id
+
+// Per-process memory statistics
+struct procinfo{
+    int pid;               // Process ID
+    int ppid;              // Parent process ID
+    int state;             // procstate value
+    uint sz;               // Address-space size
+    char name[16];         // Process name
+    uint ws_pages;         // Pages referenced in the last scan window
+    uint ws_avg;           // Smoothed working set (pages)
+    uint dirty_pages;      // Pages written in the last scan window
+    uint dirty_avg;        // Smoothed dirty pages per window
+    uint ws_window;        // Scan window length (ticks)
+    int rss_pages;         // Resident user pages
+    int shared_pages;      // Resident pages whose frame has other mappers
+    int cow_pages;         // Read-only pages waiting for a COW fault
+    int pt_pages;          // Page directory + page-table pages
+    int fork_policy;       // fork() copy policy (forkpolicy.h)
+    uint fork_wfrac;       // Smoothed % of memory children wrote after fork
+    uint stack_pages;      // Mapped user stack pages
+    uint stack_limit;      // Stack limit (pages)
+};
+int get_procinfo(int pid, struct procinfo *uinfo);   // pid <= 0 is "self"
+
+// Memory usage hints (advice values in madvise.h)
+int madvise(void *addr, uint len, int advice);
+
+// Physical frame change log
+#define PFEV_ALLOC 1
+#define PFEV_FREE  2
+struct pfevent{
+    uint seq;              // Global sequence number
+    uint pfn;              // Physical frame number
+    int pid;               // Owner on alloc, previous owner on free (-1 if none)
+    int event;             // PFEV_ALLOC or PFEV_FREE
+    uint tick;             // Tick of the event
+};
+struct pfev_cursor{
+    uint pos[8];           // Per-CPU read position (NCPU); zero to start
+    uint lost;             // Events overwritten before they were read
+};
+int physmem_events(struct pfevent *buf, int n, struct pfev_cursor *cursor); // n == 0: seek to end 
+
+// Out-of-memory killer
+struct oom_event{
+    uint seq;              // Event number (1, 2, ...)
+    uint tick;             // Tick of the kill
+    int pid;               // Victim
+    char name[16];         // Victim name
+    int frames;            // Victim resident + page-table frames
+    int score;             // Badness score the victim was ranked by
+    int trigger;           // Process whose allocation failed
+};
+int oom_adjust(int pid, int adj);                // -1000 (never) .. 1000 (first); pid <= 0 is "self"
+int oom_events(struct oom_event *buf, int n);    // most recent kills, oldest first
+
+// Page-fault statistics
+#define FLT_COW_COPY  0    // write to a shared COW page, copied
+#define FLT_COW_REUSE 1    // write to a COW page nobody else maps, reused
+#define FLT_ZERO      2    // demand-zero fill of a madvise() hole
+#define FLT_FATAL     3    // unresolved, process killed
+#define FLT_STACK     4    // user stack grown into its reservation
+#define FLT_NTYPE     5
+#define FLT_NBUCKET   32
+struct faultstat{
+    uint count[8][FLT_NTYPE];           // Per-CPU fault counts (NCPU rows)
+    uint hist[FLT_NTYPE][FLT_NBUCKET];  // hist[t][b]: faults of 2^b..2^(b+1)-1 cycles
+    uint cycles_lo[FLT_NTYPE];          // Total cycles, low/high 32 bits
+    uint cycles_hi[FLT_NTYPE];
+    int ncpu;                           // CPUs present
+};
+int faultstat(struct faultstat *buf, int reset);   // buf may be 0 to only reset
+
+// Physical memory compaction
+struct compact_stats{
+    uint free_frames;      // Free frames after the run
+    uint largest_before;   // Longest run of free frames before
+    uint largest_after;    // Longest run of free frames after
+    uint blocks_before;    // Free 4MB-aligned blocks before
+    uint blocks_after;     // Free 4MB-aligned blocks after
+    uint moved;            // Frames migrated
+    uint skipped;          // Candidates left in place
+};
+int compact(struct compact_stats *st);
+
+// fork() copy policy (values in forkpolicy.h)
+int setforkpolicy(int policy);   // returns the previous policy
+
+// Growable user stack
+int setstacklimit(int pages);    // returns the previous limit; raising applies from the next exec
+
+// Translation benchmark: time n (<= 512) lookups of va[] through a page-table
+// walk (mode 0) or the IPT hash (mode 1, kernels built with IPT_HASHED=1)
+int vtopbench(uint *va, uint *pa, int n, int mode);   // returns cycles, -1 if the mode is not built
\ No newline at end of file
@@ -8,11 +8,52 @@
 #include "elf.h"
 #include "ipt.h"
 #include "softtlb.h"
+#include "mckpt.h"
+#include "wss.h"
+#include "rss.h"
+#include "oom.h"
+#include "pgfault.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
 
-// Software virtual to physical address translation with software TLB support
+// Translate v by walking pgdir's two-level page table. Returns 0 and the
+// page-aligned pa and P/W/U flags, or -1 if v is not mapped.
+static int
+vtop_walk(pde_t *pgdir, uint v, uint *pa, uint *flags)
+{
+  pde_t *pde = &pgdir[PDX(v)];
+  if((*pde & PTE_P) == 0) return -1;
+
+  // page table page is present
+  pte_t *pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
+  pte_t pte = pgtab[PTX(v)];
+  if((pte & PTE_P) == 0) return -1;
+
+  // page is present
+  *pa = PTE_ADDR(pte);
+  *flags = pte & (PTE_P | PTE_W | PTE_U);
+  return 0;
+}
+
+#ifdef IPT_HASHED
+// Translate v with the IPT (pgdir, va) index. Kernel mappings are not
+// recorded in the IPT, so they are still walked.
+static int
+vtop_hash(pde_t *pgdir, uint v, uint *pa, uint *flags)
+{
+  if(v >= KERNBASE || pgdir == kpgdir)
+    return vtop_walk(pgdir, v, pa, flags);
+  if(ipt_lookup_va(pgdir, v, pa, flags) < 0)
+    return -1;
+  *flags &= PTE_P | PTE_W | PTE_U;
+  return 0;
+}
+#endif
+
+// Software virtual to physical address translation with software TLB support.
+// On an STLB miss, a kernel built with -DIPT_HASHED resolves through the
+// IPT instead of the page tables.
 int
 sw_vtop(pde_t *pgdir, const void *va, uint *pa_out, uint *flags_out)
 {
@@ -26,21 +67,14 @@ sw_vtop(pde_t *pgdir, const void *va, uint *pa_out, uint *flags_out)
     return 0;
   }
 
-  // not found in software TLB, do normal page table walk
-  pde_t *pde = &pgdir[PDX(v)];
-  if((*pde & PTE_P) == 0) return -1;
-
-  // page table page is present
-  pte_t *pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
-  pte_t pte = pgtab[PTX(v)];
-  if((pte & PTE_P) == 0) return -1;
-
-  // page is present
-  uint pa = PTE_ADDR(pte) | (v & 0xFFF);
-  uint flags = 0;
-  if(pte & PTE_P) flags |= 0x001;
-  if(pte & PTE_W) flags |= 0x002;
-  if(pte & PTE_U) flags |= 0x004;
+  // not found in software TLB, translate the slow way
+  uint pa, flags;
+#ifdef IPT_HASHED
+  if(vtop_hash(pgdir, v, &pa, &flags) < 0) return -1;
+#else
+  if(vtop_walk(pgdir, v, &pa, &flags) < 0) return -1;
+#endif
+  pa |= v & 0xFFF;
 
   // File out results
   if(pa_out)    *pa_out    = pa;
@@ -53,6 +87,38 @@ sw_vtop(pde_t *pgdir, const void *va, uint *pa_out, uint *flags_out)
   return 0;
 }
 
+// Time n translations of the addresses in va[] through mode (VTOP_WALK or
+// VTOP_HASH), bypassing the STLB, with interrupts off. pa[i] receives the
+// page-aligned frame, or 0xFFFFFFFF if va[i] is not mapped. Returns the
+// elapsed cycles, or -1 if the kernel was built without that mode.
+int
+vtop_bench(pde_t *pgdir, uint *va, uint *pa, int n, int mode)
+{
+  uint flags, t0, t1;
+
+  pushcli();
+  t0 = rdtsc_lo();
+  if(mode == VTOP_WALK){
+    for(int i = 0; i < n; i++)
+      if(vtop_walk(pgdir, va[i], &pa[i], &flags) < 0)
+        pa[i] = ~0;
+  }
+#ifdef IPT_HASHED
+  else if(mode == VTOP_HASH){
+    for(int i = 0; i < n; i++)
+      if(vtop_hash(pgdir, va[i], &pa[i], &flags) < 0)
+        pa[i] = ~0;
+  }
+#endif
+  else{
+    popcli();
+    return -1;
+  }
+  t1 = rdtsc_lo();
+  popcli();
+  return t1 - t0;
+}
+
 
 // Set up CPU's kernel segment descriptors.
 // Run once on entry on each CPU.
@@ -90,6 +156,7 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
       return 0;
     // Make sure all those PTE_P bits are zero.
     memset(pgtab, 0, PGSIZE);
+    rss_add(pgdir, RSS_PTPAGES, 1);
     // The permissions here are overly generous, but they can
     // be further restricted by the permissions in the page table
     // entries, if necessary.
@@ -120,6 +187,9 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
       uint ppg = (pa & ~0xFFF);       // physical page number
       stlb_insert(pgdir, vpg, ppg, perm | PTE_P);         // Insert into software TLB
       ipt_insert(pa >> 12, pgdir, (uint)a, perm | PTE_P); // Insert into IPT
+      rss_add(pgdir, RSS_RESIDENT, 1);                    // Account the page
+      if((perm & PTE_U) && !(perm & PTE_W))
+        rss_add(pgdir, RSS_COW, 1);
     }
 
     if(a == last)
@@ -175,6 +245,8 @@ setupkvm(void)
   if((pgdir = (pde_t*)kalloc()) == 0)
     return 0;
   memset(pgdir, 0, PGSIZE);
+  rss_register(pgdir);
+  rss_add(pgdir, RSS_PTPAGES, 1);
   if (P2V(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
@@ -282,7 +354,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 
   a = PGROUNDUP(oldsz);
   for(; a < newsz; a += PGSIZE){
-    mem = kalloc();
+    mem = oom_kalloc();
     if(mem == 0){
       cprintf("allocuvm out of memory\n");
       deallocuvm(pgdir, newsz, oldsz);
@@ -299,6 +371,30 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   return newsz;
 }
 
+#define UNMAP_BATCH 64  // pages dropped per STLB/IPT pass in deallocuvm()
+
+// Drop a batch of pages already cleared from pgdir: one STLB pass, one IPT
+// pass, then the frames nobody maps any more go back as a single list.
+static void
+unmap_batch(pde_t *pgdir, uint *va, uint *pfn, int n)
+{
+  int refs[UNMAP_BATCH];
+  char *frames = 0;
+
+  if(n == 0)
+    return;
+  stlb_invalidate_batch(pgdir, va, n);
+  ipt_remove_batch(pgdir, pfn, va, n, refs);
+  for(int i = 0; i < n; i++){
+    if(refs[i] != 0)
+      continue;
+    char *v = P2V(pfn[i] << 12);
+    *(char**)v = frames;  // chain for kfree_list
+    frames = v;
+  }
+  kfree_list(frames);
+}
+
 // Deallocate user pages to bring the process size from oldsz to
 // newsz.  oldsz and newsz need not be page-aligned, nor does newsz
 // need to be less than oldsz.  oldsz can be larger than the actual
@@ -308,10 +404,15 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 {
   pte_t *pte;
   uint a, pa;
+  uint va[UNMAP_BATCH], pfn[UNMAP_BATCH];
+  int n = 0, nres = 0, ncow = 0;
 
   if(newsz >= oldsz)
     return oldsz;
 
+  // Checkpoint hook: pages above newsz no longer match any checkpoint
+  mckpt_note_shrink(pgdir, newsz);
+
   a = PGROUNDUP(newsz);
   for(; a  < oldsz; a += PGSIZE){
     pte = walkpgdir(pgdir, (char*)a, 0);
@@ -321,20 +422,28 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       pa = PTE_ADDR(*pte);
       if(pa == 0)
         panic("kfree");
+      if((*pte & PTE_U) && !(*pte & PTE_W))
+        ncow++;
+      nres++;
+      *pte = 0;
 
-      // IPT hook: remove this mapping 
-      if((uint)a < KERNBASE && pgdir != kpgdir){
-        stlb_invalidate_one(pgdir, ((uint)a) & ~0xFFF); // Invalidate from software TLB
-        ipt_remove(pa >> 12, pgdir, a);                 // Remove from IPT
+      // IPT/STLB entries and the frame are dropped a batch at a time
+      va[n] = a;
+      pfn[n] = pa >> 12;
+      if(++n == UNMAP_BATCH){
+        unmap_batch(pgdir, va, pfn, n);
+        n = 0;
       }
-      // Free the physical memory page if no more references exist
-      if(ipt_pfn_refs(pa >> 12) == 0){
-        char *v = P2V(pa);
-        kfree(v);
-      }
-      *pte = 0;
     }
   }
+  unmap_batch(pgdir, va, pfn, n);
+
+  // Unaccount the pages
+  if(pgdir != kpgdir){
+    rss_add(pgdir, RSS_RESIDENT, -nres);
+    if(ncow)
+      rss_add(pgdir, RSS_COW, -ncow);
+  }
   return newsz;
 }
 
@@ -344,21 +453,25 @@ void
 freevm(pde_t *pgdir)
 {
   uint i;
+  char *ptpages = 0;
 
   if(pgdir == 0) panic("freevm: no pgdir");
-  
-  // IPT and software TLB hook: remove all entries of this pgdir
-  stlb_invalidate_all_of(pgdir);
-  ipt_remove_all_of(pgdir);
-  
+
+  // Checkpoint hook: release checkpoints taken of this address space
+  mckpt_drop_all(pgdir);
+
+  // deallocuvm() drops the IPT and software TLB entries along with the pages
   deallocuvm(pgdir, KERNBASE, 0);
   for(i = 0; i < NPDENTRIES; i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
-      kfree(v);
+      *(char**)v = ptpages;  // chain for kfree_list
+      ptpages = v;
     }
   }
-  kfree((char*)pgdir);
+  rss_unregister(pgdir);
+  *(char**)pgdir = ptpages;
+  kfree_list((char*)pgdir);
 }
 
 // Clear PTE_U on a page. Used to create an inaccessible
@@ -388,9 +501,9 @@ copyuvm(pde_t *pgdir, uint sz)
     return 0;
   for(i = 0; i < sz; i += PGSIZE){
     if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
+      continue;  // unused part of the stack reservation
     if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
+      continue;  // madvise(MADV_DONTNEED) hole or unused stack page
     pa = PTE_ADDR(*pte);
     flags = PTE_FLAGS(*pte);
     if((mem = kalloc()) == 0)
@@ -430,6 +543,8 @@ copyuvm_cow(pde_t *pgdir, uint sz)
       stlb_invalidate_one(pgdir, va);             // Invalidate from software TLB
       ipt_remove(pa >> 12, pgdir, va);            // Remove from IPT
       ipt_insert(pa >> 12, pgdir, va, (flags & ~PTE_W) | PTE_P); // Insert updated entry into IPT
+      if(flags & PTE_U)
+        rss_add(pgdir, RSS_COW, 1);              // Parent page now waits for a COW fault
       lcr3(V2P(pgdir));                          // Flush hardware TLB by reloading CR3
     }
 
@@ -444,6 +559,10 @@ copyuvm_cow(pde_t *pgdir, uint sz)
   return d;
 }
 
+// Resolve a write fault on a COW page. A frame nobody else maps any more
+// (the other side exited or dropped it) is made writable in place; a shared
+// one is copied. Returns COW_COPIED or COW_REUSED on success, 0 if va is
+// not a COW page, -1 if out of memory.
 int
 cow_fault(pde_t *pgdir, uint va)
 {
@@ -452,14 +571,33 @@ cow_fault(pde_t *pgdir, uint va)
   if(pte == 0) return 0;             // PTE does not exist
   if((*pte & PTE_P) == 0) return 0;  // Not present
   if((*pte & PTE_W) != 0) return 0;  // Already writable
+  if((*pte & PTE_U) == 0) return 0;  // Guard page, never shared COW
 
   // old physical address and flags
   uint old_pa  = PTE_ADDR(*pte);
   uint flags   = PTE_FLAGS(*pte);
-  
-  // Allocate new physical page
-  char *mem = kalloc();
+
+  // Last mapper: take the frame over instead of copying it
+  if(ipt_pfn_refs(old_pa >> 12) == 1){
+    stlb_invalidate_one(pgdir, uva);
+    ipt_insert(old_pa >> 12, pgdir, uva, flags | PTE_W | PTE_P); // refresh flags
+    *pte = old_pa | flags | PTE_W | PTE_P;
+    rss_add(pgdir, RSS_COW, -1);
+    lcr3(V2P(pgdir));
+    mckpt_note_write(pgdir, uva);
+    return COW_REUSED;
+  }
+
+  // Allocate new physical page (may OOM-kill another process and wait)
+  char *mem = oom_kalloc();
   if(mem == 0) return -1;
+
+  // oom_kalloc() may have slept: the other mapper may have gone away or
+  // compaction may have moved the frame, so start over if the PTE changed
+  if(PTE_ADDR(*pte) != old_pa || (*pte & (PTE_P | PTE_W)) != PTE_P){
+    kfree(mem);
+    return cow_fault(pgdir, va);
+  }
   
   // Copy data from old physical page to new page
   memmove(mem, (char*)P2V(old_pa), PGSIZE);
@@ -469,18 +607,135 @@ cow_fault(pde_t *pgdir, uint va)
   uint new_flags = (flags | PTE_W); 
 
   // Update page tables and IPT/TLB
+  uint old_pfn = old_pa >> 12;
+  int refs;
   stlb_invalidate_one(pgdir, uva);
-  ipt_remove(old_pa >> 12, pgdir, uva);
+  ipt_remove_batch(pgdir, &old_pfn, &uva, 1, &refs);
   ipt_insert(new_pa >> 12, pgdir, uva, new_flags | PTE_P);
 
   // Update the PTE to point to the new physical page with write permissions
   *pte = (new_pa | new_flags | PTE_P);
+  rss_add(pgdir, RSS_COW, -1);
 
   // Flush hardware TLB
   lcr3(V2P(pgdir));
 
+  // Free the old page if we were its last mapper (e.g. a discarded
+  // checkpoint); refs was read in the same lock hold as the removal, so
+  // a sharer tearing down concurrently cannot also see 0
+  if(refs == 0)
+    kfree(P2V(old_pa));
+
+  // Checkpoint hook: this page now differs from any checkpoint
+  mckpt_note_write(pgdir, uva);
+
   // Success
-  return 1; 
+  return COW_COPIED;
+}
+
+// Handle a fault on a not-present page below sz, i.e. a range dropped by
+// madvise(MADV_DONTNEED): map a zeroed page, plus up to `around` following
+// holes for sequential access.
+// Returns 1 on success, 0 if va is not a hole, -1 if out of memory.
+int
+zero_fault(pde_t *pgdir, uint sz, uint va, uint around)
+{
+  uint uva = PGROUNDDOWN(va);
+  if(uva >= sz) return 0;
+
+  pte_t *pte = walkpgdir(pgdir, (void*)uva, 0);
+  if(pte && (*pte & PTE_P)) return 0; // not a hole
+
+  for(uint a = uva, n = 0; a < sz && n <= around; a += PGSIZE, n++){
+    pte = walkpgdir(pgdir, (void*)a, 0);
+    if(pte && (*pte & PTE_P)) break;  // end of the hole
+
+    char *mem = (a == uva) ? oom_kalloc() : kalloc(); // never kill for fault-around
+    if(mem == 0) return (a == uva) ? -1 : 1;
+    memset(mem, 0, PGSIZE);
+    if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
+      kfree(mem);
+      return (a == uva) ? -1 : 1;
+    }
+  }
+  return 1;
+}
+
+// Fill every hole in [start, end) (madvise(MADV_WILLNEED)).
+// Returns 0 on success, -1 if out of memory.
+int
+prefaultuvm(pde_t *pgdir, uint start, uint end)
+{
+  for(uint a = PGROUNDDOWN(start); a < end; a += PGSIZE)
+    if(zero_fault(pgdir, end, a, 0) < 0)
+      return -1;
+  return 0;
+}
+
+// Make pgdir's page at va share snap's frame read-only (COW), dropping
+// whatever pgdir mapped there before. Used to roll an address space back
+// to a checkpoint. Returns 1 if the mapping changed, 0 if it already
+// matched, -1 on allocation failure.
+int
+cowshare_page(pde_t *pgdir, pde_t *snap, uint va)
+{
+  uint uva = PGROUNDDOWN(va);
+  pte_t *spte = walkpgdir(snap, (void*)uva, 0);
+  pte_t *pte  = walkpgdir(pgdir, (void*)uva, 0);
+
+  // already sharing the checkpoint's frame
+  if(spte && (*spte & PTE_P) && pte && (*pte & PTE_P) &&
+     PTE_ADDR(*pte) == PTE_ADDR(*spte))
+    return 0;
+
+  // drop the current mapping
+  if(pte && (*pte & PTE_P)){
+    uint pa = PTE_ADDR(*pte), pfn = pa >> 12;
+    int refs;
+    stlb_invalidate_one(pgdir, uva);
+    ipt_remove_batch(pgdir, &pfn, &uva, 1, &refs);  // remove and count at once
+    rss_add(pgdir, RSS_RESIDENT, -1);
+    if((*pte & PTE_U) && !(*pte & PTE_W))
+      rss_add(pgdir, RSS_COW, -1);
+    if(refs == 0)
+      kfree(P2V(pa));
+    *pte = 0;
+  }
+
+  // nothing mapped there at checkpoint time
+  if(spte == 0 || (*spte & PTE_P) == 0)
+    return 1;
+
+  // share the checkpoint's frame, read-only so the next write copies it
+  if(mappages(pgdir, (void*)uva, PGSIZE, PTE_ADDR(*spte),
+              PTE_FLAGS(*spte) & ~(PTE_W | PTE_P)) < 0)
+    return -1;
+  return 1;
+}
+
+// Sample and clear the accessed/dirty bits of pgdir's PTE for va.
+// Returns the PTE_A|PTE_D bits that were set. The caller is responsible
+// for flushing TLBs that may still hold the old bits.
+uint
+pte_clear_ad(pde_t *pgdir, uint va)
+{
+  pte_t *pte = walkpgdir(pgdir, (void*)va, 0);
+  if(pte == 0 || (*pte & PTE_P) == 0)
+    return 0;
+  return __sync_fetch_and_and(pte, ~(PTE_A | PTE_D)) & (PTE_A | PTE_D);
+}
+
+// Point pgdir's PTE for va at physical address to instead of from,
+// keeping its flags (page migration). With to == from this only checks
+// the mapping. Returns 0, or -1 if va does not map from.
+int
+pte_retarget(pde_t *pgdir, uint va, uint from, uint to)
+{
+  pte_t *pte = walkpgdir(pgdir, (void*)va, 0);
+  if(pte == 0 || (*pte & PTE_P) == 0 || PTE_ADDR(*pte) != from)
+    return -1;
+  *pte = to | PTE_FLAGS(*pte);
+  return 0;
 }
 
 //PAGEBREAK!
@@ -491,13 +746,70 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
   return (char*)P2V(PTE_ADDR(*pte));
 }
 
+// Before the kernel writes to the current process's page at va0 through
+// its direct mapping, make the page present (stack growth or madvise hole)
+// and private (COW), since the hardware will not fault on that path.
+// Returns -1 if that failed (out of memory, or a page growstack refuses).
+static int
+uvm_prepare_write(pde_t *pgdir, uint va0)
+{
+  struct proc *p = myproc();
+  pte_t *pte;
+  int r;
+
+  if(p == 0 || p->pgdir != pgdir || va0 >= p->sz)
+    return 0;
+  pte = walkpgdir(pgdir, (void*)va0, 0);
+  if(pte == 0 || (*pte & PTE_P) == 0){
+    if((r = growstack(va0, 0)) == 0)
+      r = zero_fault(pgdir, p->sz, va0, 0);
+    return r < 0 ? -1 : 0;
+  }
+  if((*pte & PTE_U) && (*pte & PTE_W) == 0)
+    return cow_fault(pgdir, va0) < 0 ? -1 : 0;
+  return 0;
+}
+
+// Before the kernel reads or, with write set, writes the current
+// process's bytes [va, va+n) directly (fetchint, fetchstr, argptr),
+// grow the stack down to them, fill any madvise() holes and, for a
+// write, give it private copies of pages shared COW. A fault there may
+// come with a spinlock held (e.g. piperead) and cannot sleep or fail,
+// whereas here oom_kalloc() may still kill for memory. Returns -1 if any
+// of them lies in the guard page or the unreserved pages below the
+// stack, which stay unmapped, or if memory runs out, so the system call
+// fails instead of faulting in the kernel.
+int
+uvm_prepare(uint va, uint n, int write)
+{
+  struct proc *p = myproc();
+  pte_t *pte;
+  uint a, last;
+  int r;
+
+  if(n == 0)
+    return 0;
+  last = PGROUNDDOWN(va + n - 1);
+  for(a = PGROUNDDOWN(va); ; a += PGSIZE){
+    if((r = growstack(a, 0)) < 0)
+      return -1;
+    if(r == 0 && zero_fault(p->pgdir, p->sz, a, 0) < 0)
+      return -1;
+    if(write && (pte = walkpgdir(p->pgdir, (char*)a, 0)) != 0 &&
+       (*pte & (PTE_P|PTE_U|PTE_W)) == (PTE_P|PTE_U) && cow_fault(p->pgdir, a) < 0)
+      return -1;
+    if(a == last)
+      return 0;
+  }
+}
+
 // Copy len bytes from p to user address va in page table pgdir.
 // Most useful when pgdir is not the current page table.
 // uva2ka ensures this only works for PTE_U pages.
@@ -506,10 +818,17 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
 {
   char *buf, *pa0;
   uint n, va0;
+  pte_t *pte;
 
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
+    if(uvm_prepare_write(pgdir, va0) < 0)
+      return -1;
+    // a page still shared COW would take the write for every sharer
+    pte = walkpgdir(pgdir, (char*)va0, 0);
+    if(pte == 0 || (*pte & PTE_W) == 0)
+      return -1;
     pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;
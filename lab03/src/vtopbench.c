@@ -0,0 +1,111 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "bench.h"
+#include "madvise.h"
+
+#define PGSZ    4096
+#define MAXLOOK 512     // vtopbench() limit per call
+
+#define MODE_WALK 0
+#define MODE_HASH 1
+
+static uint va[MAXLOOK];
+static uint pa_walk[MAXLOOK];
+static uint pa_hash[MAXLOOK];
+
+// Grow the heap by regions spans of span pages and keep only the first
+// pages pages of each, so the address space is large and mostly holes.
+// Returns the number of addresses recorded in va[].
+static int
+build_sparse(int regions, int pages, int span)
+{
+  int n = 0;
+  uint cur = (uint)sbrk(0);
+
+  if(cur % PGSZ && sbrk(PGSZ - cur % PGSZ) == (char*)-1) fail("sbrk align");
+  for(int r = 0; r < regions; r++){
+    char *base = sbrk(span * PGSZ);
+    if(base == (char*)-1) fail("sbrk");
+    for(int p = 0; p < pages; p++){
+      base[p * PGSZ] = (char)r;
+      if(n < MAXLOOK) va[n++] = (uint)base + p * PGSZ;
+    }
+    if(madvise(base + pages * PGSZ, (span - pages) * PGSZ, MADV_DONTNEED) < 0)
+      fail("madvise");
+  }
+  return n;
+}
+
+// shuffle the lookup order so neither mode gets a sequential walk
+static void
+shuffle(int n)
+{
+  uint seed = 12345;
+  for(int i = n - 1; i > 0; i--){
+    seed = seed * 1103515245 + 12345;
+    int j = (seed >> 8) % (i + 1);
+    uint t = va[i]; va[i] = va[j]; va[j] = t;
+  }
+}
+
+// print a / b with one decimal
+static void
+print_ratio(char *label, uint a, uint b)
+{
+  uint x = a * 10 / b;
+  printf(1, "%s: %d.%d cycles/lookup\n", label, x / 10, x % 10);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int regions = 128;  // separate heap regions
+  int pages = 2;      // mapped pages at the start of each region
+  int span = 1024;    // region size in pages (1024 = one page table each)
+  int iters = 50;
+  int i;
+
+  benchinit("vtopbench", "[-r regions] [-p pages] [-s span] [-i iters]");
+  for(i = 1; i < argc; i++){
+    char *a = argv[i];
+    if(a[0] != '-' || i + 1 >= argc) usage();
+    if(a[1] == 'r') regions = atoi(argv[++i]);
+    else if(a[1] == 'p') pages = atoi(argv[++i]);
+    else if(a[1] == 's') span = atoi(argv[++i]);
+    else if(a[1] == 'i') iters = atoi(argv[++i]);
+    else usage();
+  }
+  if(regions <= 0 || pages <= 0 || span <= pages || iters <= 0) usage();
+
+  int n = build_sparse(regions, pages, span);
+  shuffle(n);
+  printf(1, "[vtopbench] pid=%d regions=%d pages=%d span=%d (%dKB of address space), %d lookups x %d iters\n",
+         getpid(), regions, pages, span, regions * span * (PGSZ / 1024), n, iters);
+
+  // warm up, check both modes agree with each other and with vtop()
+  if(vtopbench(va, pa_walk, n, MODE_WALK) < 0) fail("walk");
+  int hashed = vtopbench(va, pa_hash, n, MODE_HASH) >= 0;
+  for(i = 0; i < n; i++){
+    uint pa, flags;
+    if(pa_walk[i] == ~0) fail("mapped page not found by walk");
+    if(vtop((void*)va[i], &pa, &flags) < 0 || (pa & ~(PGSZ - 1)) != pa_walk[i])
+      fail("walk disagrees with vtop");
+    if(hashed && pa_hash[i] != pa_walk[i])
+      fail("hash disagrees with walk");
+  }
+
+  uint tw = 0, th = 0;
+  for(int it = 0; it < iters; it++){
+    tw += vtopbench(va, pa_walk, n, MODE_WALK);
+    if(hashed)
+      th += vtopbench(va, pa_hash, n, MODE_HASH);
+  }
+
+  print_ratio("page-table walk", tw, n * iters);
+  if(hashed)
+    print_ratio("IPT hash probe ", th, n * iters);
+  else
+    printf(1, "IPT hash probe : not built (make clean; make IPT_HASHED=1)\n");
+  exit();
+}
@@ -0,0 +1,151 @@
+// wss.c — working-set estimation from PTE accessed/dirty bits
+//
+// Cpu 0 sweeps the IPT reverse map once every WSS_INTERVAL ticks, a slice
+// of buckets per timer tick so no interrupt walks the whole table. Each
+// user mapping it passes has PTE_A/PTE_D sampled and cleared, once per
+// window, and when the sweep wraps the counts are folded into
+// per-process estimates. CPUs reload %cr3 on every switchuvm(), so
+// stale TLB entries on other CPUs are gone within a tick.
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "memlayout.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "ipt.h"
+#include "wss.h"
+
+extern struct {
+  struct spinlock lock;
+  struct proc proc[NPROC];
+} ptable;
+
+// IPT buckets swept per tick, so a sweep takes one window
+#define WSS_SLICE ((IPT_HASH_SIZE + WSS_INTERVAL - 1) / WSS_INTERVAL)
+
+// per-window sample of one address space
+static struct {
+  pde_t *pgdir;
+  int pid;
+  uint accessed;
+  uint dirty;
+} wss_tab[NPROC];
+static int wss_n;
+static int wss_next;      // bucket the sweep resumes at
+static int wss_cleared;   // A/D bits cleared in this slice
+
+// wss_tab index by pgdir (open addressing, -1 = empty), so the visitor
+// does not search the table for every mapping
+#define WSS_NSLOT (2 * NPROC)
+static int wss_slot[WSS_NSLOT];
+
+// smoothed average with weight 1/2^WSS_EWMA_SHIFT on the new sample
+static inline uint
+ewma(uint avg, uint sample)
+{
+  return (avg * ((1 << WSS_EWMA_SHIFT) - 1) + sample) >> WSS_EWMA_SHIFT;
+}
+
+// wss_tab index of pgdir, or -1
+static int
+wss_find(pde_t *pgdir)
+{
+  uint h;
+
+  for(h = ((uint)pgdir >> 12) % WSS_NSLOT; wss_slot[h] >= 0; h = (h + 1) % WSS_NSLOT)
+    if(wss_tab[wss_slot[h]].pgdir == pgdir)
+      return wss_slot[h];
+  return -1;
+}
+
+// IPT visitor: account one mapping to its address space
+static void
+wss_visit(struct ipt_entry *e)
+{
+  int i = wss_find(e->pgdir);
+
+  if(i < 0)
+    return;   // address space born during this window
+  uint ad = pte_clear_ad(e->pgdir, e->va);
+  if(ad & PTE_A) wss_tab[i].accessed++;
+  if(ad & PTE_D) wss_tab[i].dirty++;
+  if(ad & (PTE_A|PTE_D)) wss_cleared = 1;
+}
+
+// Start a window: the address spaces of live processes.
+static void
+wss_begin(void)
+{
+  struct proc *p;
+  uint h;
+
+  for(h = 0; h < WSS_NSLOT; h++)
+    wss_slot[h] = -1;
+
+  acquire(&ptable.lock);
+  wss_n = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pgdir == 0) continue;
+    if(p->state != SLEEPING && p->state != RUNNABLE && p->state != RUNNING) continue;
+    wss_tab[wss_n].pgdir = p->pgdir;
+    wss_tab[wss_n].pid = p->pid;
+    wss_tab[wss_n].accessed = 0;
+    wss_tab[wss_n].dirty = 0;
+    for(h = ((uint)p->pgdir >> 12) % WSS_NSLOT; wss_slot[h] >= 0; h = (h + 1) % WSS_NSLOT)
+      ;
+    wss_slot[h] = wss_n++;
+  }
+  release(&ptable.lock);
+}
+
+// End a window: fold its samples into the per-process working-set and
+// dirty-rate estimates. The pid check skips a process that exited and
+// left its page directory to a newcomer.
+static void
+wss_end(void)
+{
+  struct proc *p;
+  int i;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pgdir == 0 || (i = wss_find(p->pgdir)) < 0 || wss_tab[i].pid != p->pid)
+      continue;
+    p->ws_pages = wss_tab[i].accessed;
+    p->dirty_pages = wss_tab[i].dirty;
+    if(p->ws_scans == 0){
+      p->ws_avg = p->ws_pages;
+      p->dirty_avg = p->dirty_pages;
+    }else{
+      p->ws_avg = ewma(p->ws_avg, p->ws_pages);
+      p->dirty_avg = ewma(p->dirty_avg, p->dirty_pages);
+    }
+    p->ws_scans++;
+  }
+  release(&ptable.lock);
+}
+
+// Timer hook: sweep the next slice of the reverse map, closing the
+// window when the sweep wraps.
+void
+wss_tick(void)
+{
+  if(wss_next == 0)
+    wss_begin();
+  wss_cleared = 0;
+  wss_next = ipt_for_buckets(wss_next, WSS_SLICE, wss_visit);
+  if(wss_next == IPT_HASH_SIZE){
+    wss_end();
+    wss_next = 0;
+  }
+
+  // drop this CPU's cached A/D bits
+  if(!wss_cleared)
+    return;
+  if(myproc())
+    lcr3(V2P(myproc()->pgdir));
+  else
+    switchkvm();
+}
@@ -0,0 +1,19 @@
+// Working-set estimation from PTE accessed/dirty bits
+#ifndef WSS_H
+#define WSS_H
+
+#include "types.h"
+
+// x86 PTE bits set by hardware on access / write
+#ifndef PTE_A
+#define PTE_A 0x020
+#endif
+#ifndef PTE_D
+#define PTE_D 0x040
+#endif
+
+#define WSS_INTERVAL 100 // ticks per scan window
+#define WSS_EWMA_SHIFT 2 // avg += (sample - avg) / 4
+
+void wss_tick(void);     // called from the timer interrupt on cpu 0
+#endif